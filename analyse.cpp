@@ -0,0 +1,108 @@
+#include "enums.hpp"
+#include "eventlog.hpp"
+#include "scoring.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+// summary statistics over an event log written by a game (see eventlog.hpp)
+//
+//   tetris-analyse events.log
+
+const char* pieceNames = "IJLOSTZ";
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " events.log" << std::endl;
+        return -1;
+    }
+    EventLogReader log(argv[1]);
+    if (!log.isOpen()) {
+        std::cerr << "could not read event log " << argv[1] << std::endl;
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::array<std::uint64_t, 8> byType = {};
+    // [piece][kick + 1], kick -1 being a failed rotation
+    std::array<std::array<std::uint64_t, 6>, 7> kicks = {};
+    std::array<std::uint64_t, 5> clears = {};
+    // [spin][lines]
+    std::array<std::array<std::uint64_t, 5>, 3> spins = {};
+    std::uint64_t perfectClears = 0;
+    std::uint64_t backToBacks = 0;
+    std::uint64_t garbage = 0;
+    std::array<std::uint64_t, 7> deathPiece = {};
+    std::array<std::uint64_t, 16> deathColumn = {};
+    std::uint64_t pieces = 0;
+    std::uint64_t points = 0;
+    int maxCombo = 0;
+
+    for (const GameEvent& e : log) {
+        if (e.type < byType.size()) byType[e.type]++;
+        switch (e.type) {
+        case RotateEvent:
+            if (e.piece < 7 && e.kick >= -1 && e.kick < 5) kicks[e.piece][e.kick + 1]++;
+            break;
+        case LockEvent: pieces++; break;
+        case ClearEvent:
+            if (e.lines <= 4) clears[e.lines]++;
+            if (e.spin <= FullSpin && e.lines <= 4) spins[e.spin][e.lines]++;
+            perfectClears += (e.flags & PerfectClearFlag) != 0;
+            backToBacks += (e.flags & BackToBackFlag) != 0;
+            garbage += e.garbage;
+            points += e.scoreDelta;
+            if (e.combo > maxCombo) maxCombo = e.combo;
+            break;
+        case GameOverEvent:
+            if (e.piece < 7) deathPiece[e.piece]++;
+            if (e.x >= 0 && e.x < int(deathColumn.size())) deathColumn[e.x]++;
+            break;
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::uint64_t games = byType[GameOverEvent];
+    std::cout << log.size() << " events, " << pieces << " pieces locked, " << games
+              << " games over" << std::endl;
+    std::cout << "scanned in " << elapsed.count() << "s ("
+              << log.size() / elapsed.count() / 1e6 << "M events/s)" << std::endl;
+
+    std::cout << std::endl << "rotations by kick test (- is failed)" << std::endl;
+    std::cout << "piece        -        0        1        2        3        4" << std::endl;
+    for (int p = 0; p < 7; p++) {
+        std::cout << "    " << pieceNames[p];
+        for (auto n : kicks[p]) {
+            std::cout.width(9);
+            std::cout << n;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << std::endl << "clears: singles " << clears[1] << ", doubles " << clears[2]
+              << ", triples " << clears[3] << ", tetrises " << clears[4] << std::endl;
+    std::cout << "points from clears " << points << ", longest combo " << maxCombo << std::endl;
+    std::cout << "T-spins: zero " << spins[FullSpin][0] << ", singles " << spins[FullSpin][1]
+              << ", doubles " << spins[FullSpin][2] << ", triples " << spins[FullSpin][3]
+              << std::endl;
+    std::cout << "minis: zero " << spins[MiniSpin][0] << ", singles " << spins[MiniSpin][1]
+              << ", doubles " << spins[MiniSpin][2] << std::endl;
+    std::cout << "perfect clears " << perfectClears << ", back-to-backs " << backToBacks
+              << ", garbage sent " << garbage << std::endl;
+
+    if (games > 0) {
+        std::cout << std::endl << "games over by piece:";
+        for (int p = 0; p < 7; p++)
+            std::cout << " " << pieceNames[p] << "=" << deathPiece[p];
+        std::cout << std::endl << "games over by column:";
+        for (std::size_t x = 0; x < deathColumn.size(); x++)
+            if (deathColumn[x]) std::cout << " " << x << "=" << deathColumn[x];
+        std::cout << std::endl << "pieces per game " << double(pieces) / games << std::endl;
+    }
+    return 0;
+}
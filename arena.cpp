@@ -0,0 +1,21 @@
+#include "arena.hpp"
+
+Arena::Arena(std::size_t bytes)
+  : block(std::make_unique_for_overwrite<std::byte[]>(bytes)), capacity(bytes)
+{
+}
+
+void Arena::reset() { top = 0; }
+
+std::size_t Arena::used() { return top; }
+
+std::size_t Arena::size() { return capacity; }
+
+void* Arena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    // the block comes from new, so it is aligned for anything and offsets are enough
+    std::size_t start = (top + alignment - 1) & ~(alignment - 1);
+    if (start > capacity || bytes > capacity - start) return nullptr;
+    top = start + bytes;
+    return block.get() + start;
+}
@@ -0,0 +1,47 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// a bump allocator: one block allocated up front, handed out front to back and taken back
+// all at once. nothing is ever destroyed, so it only holds trivially destructible types, and
+// emptying it is a single store however much was in it
+
+class Arena
+{
+public:
+    explicit Arena(std::size_t bytes);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // count default constructed objects, nullptr once the arena is full
+    template <typename T> T* make(std::size_t count = 1)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arenas never destroy anything");
+        void* memory = allocate(sizeof(T) * count, alignof(T));
+        if (!memory) return nullptr;
+        T* objects = static_cast<T*>(memory);
+        for (std::size_t i = 0; i < count; i++)
+            new (objects + i) T();
+        return objects;
+    }
+
+    // forget everything handed out
+    void reset();
+
+    std::size_t used();
+    std::size_t size();
+
+private:
+    std::unique_ptr<std::byte[]> block;
+    std::size_t capacity;
+    std::size_t top = 0;
+
+    void* allocate(std::size_t bytes, std::size_t alignment);
+};
+
+#endif  // ARENA_H_
@@ -0,0 +1,422 @@
+#include "batch.hpp"
+
+#include "timing.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// the lane loops of gravity, as functions for the restrict arguments
+
+void fallLanes(int lanes, const std::uint8_t* __restrict over,
+               const std::uint8_t* __restrict below, const std::uint8_t* __restrict set,
+               std::uint8_t* __restrict locking, std::int8_t* __restrict y,
+               std::int8_t* __restrict moveKick)
+{
+    for (int lane = 0; lane < lanes; lane++) {
+        std::uint8_t live = !over[lane];
+        std::uint8_t falls = live & !below[lane];
+        locking[lane] = live & set[lane] & below[lane];
+        y[lane] -= falls;
+        // falling means the last move was not a rotation, -1 has every bit set
+        moveKick[lane] |= -std::int8_t(falls);
+    }
+}
+
+void setLanes(int lanes, const std::uint8_t* __restrict over,
+              const std::uint8_t* __restrict below, const std::uint8_t* __restrict rests,
+              std::uint8_t* __restrict set)
+{
+    for (int lane = 0; lane < lanes; lane++) {
+        std::uint8_t live = !over[lane];
+        set[lane] |= live & (below[lane] | rests[lane]);
+    }
+}
+
+}  // namespace
+
+BatchEngine::BatchEngine(const std::vector<unsigned int>& seeds, LockMode mode, int level)
+  : count(seeds.size()),
+    lockMode(mode),
+    startLevel(level),
+    rows(std::size_t(boardRows) * seeds.size(), fullRow),
+    piece(count),
+    rotation(count),
+    x(count),
+    y(count),
+    set(count),
+    moveKick(count, -1),
+    lockTicks(count),
+    lockResets(count),
+    lowestY(count),
+    gravityCarried(count),
+    hold(count, -1),
+    holdSet(count),
+    swappable(count, 1),
+    gameOver(count),
+    score(count),
+    scorers(count),
+    lastClear(count),
+    pieceCount(count),
+    upcoming(count),
+    below(count),
+    locking(count),
+    spins(count),
+    resting(count),
+    fullRows(count)
+{
+    for (int p = 0; p < 7; p++) {
+        shapes[p] = shapeOf(Piece(p));
+        for (int r = 0; r < 4; r++) {
+            shapeLeft[p * 4 + r] = shapes[p].left[r];
+            shapeBottom[p * 4 + r] = shapes[p].bottom[r];
+            for (int i = 0; i < 4; i++)
+                shapeRows[(p * 4 + r) * 4 + i] = shapes[p].rows[r][i];
+        }
+    }
+    generators.reserve(count);
+    for (int lane = 0; lane < count; lane++) {
+        generators.emplace_back(seeds[lane]);
+        restart(lane, seeds[lane]);
+    }
+}
+
+int BatchEngine::lanes() { return count; }
+
+void BatchEngine::restart(int lane, unsigned int seed) { restart(lane, seed, startLevel); }
+
+void BatchEngine::restart(int lane, unsigned int seed, int level)
+{
+    for (int yy = 0; yy < HEIGHT; yy++)
+        row(lane, yy) = wallRow;
+    generators[lane] = RandomGenerator(seed);
+    hold[lane] = -1;
+    holdSet[lane] = 0;
+    swappable[lane] = 1;
+    gameOver[lane] = 0;
+    score[lane] = 0;
+    scorers[lane] = Scorer(level);
+    lastClear[lane] = ClearResult();
+    pieceCount[lane] = 0;
+    // same order of generator calls as Game's constructor
+    for (int i = 0; i < Game::previewSize; i++)
+        upcoming[lane][i] = generators[lane].getNextPiece();
+    nextPiece(lane);
+}
+
+void BatchEngine::apply(const Action* actions)
+{
+    for (int lane = 0; lane < count; lane++) {
+        locking[lane] = 0;
+        if (gameOver[lane]) continue;
+        switch (actions[lane]) {
+        case ActionLeft: moveHorizontal(lane, -1); break;
+        case ActionRight: moveHorizontal(lane, 1); break;
+        case ActionClockwise: rotate(lane, Clockwise); break;
+        case ActionCounterClockwise: rotate(lane, CounterClockwise); break;
+        case ActionSoftdrop:
+            if (lockMode == DelayLock)
+                fall(lane, 1);
+            else
+                moveDownOrAdd(lane);
+            break;
+        case ActionHarddrop:
+            if (lockMode == DelayLock) {
+                fall(lane, dropDistance(lane));
+                locking[lane] = 1;
+                break;
+            }
+            while (!set[lane])
+                moveDownOrAdd(lane);
+            moveDownOrAdd(lane);
+            break;
+        case ActionHold: holdPiece(lane); break;
+        default: break;
+        }
+    }
+    resolveLocks();
+}
+
+void BatchEngine::gravity()
+{
+    if (lockMode == DelayLock) {
+        for (int lane = 0; lane < count; lane++) {
+            locking[lane] = 0;
+            if (!gameOver[lane]) fall(lane, 1);
+        }
+        return;
+    }
+    // the same steps as moveDownOrAdd, each one a pass over every lane
+    collidesBelow(below.data());
+    fallLanes(count, gameOver.data(), below.data(), set.data(), locking.data(), y.data(),
+              moveKick.data());
+    // resting pieces are set, pieces that moved are set if they now rest on something
+    collidesBelow(resting.data());
+    setLanes(count, gameOver.data(), below.data(), resting.data(), set.data());
+    resolveLocks();
+}
+
+void BatchEngine::collidesBelow(std::uint8_t* __restrict out)
+{
+    const int lanes = count;
+    const std::uint32_t* __restrict board = rows.data();
+    const std::uint8_t* __restrict pieceOf = piece.data();
+    const std::uint8_t* __restrict rotationOf = rotation.data();
+    const std::int8_t* __restrict xOf = x.data();
+    const std::int8_t* __restrict yOf = y.data();
+    const int* __restrict lefts = shapeLeft.data();
+    const int* __restrict bottoms = shapeBottom.data();
+    const std::uint32_t* __restrict bits = shapeRows.data();
+    for (int lane = 0; lane < lanes; lane++) {
+        int k = pieceOf[lane] * 4 + rotationOf[lane];
+        int shift = xOf[lane] + lefts[k] + boardPadX;
+        int base = (yOf[lane] - 1 + bottoms[k] + boardPadY) * lanes + lane;
+        std::uint32_t hit = 0;
+        for (int i = 0; i < 4; i++)
+            hit |= board[base + i * lanes] & (bits[k * 4 + i] << shift);
+        out[lane] = hit != 0;
+    }
+}
+
+void BatchEngine::tick()
+{
+    if (lockMode != DelayLock) return;
+    // drop distances differ from lane to lane, so this is a plain loop per lane, but one that
+    // moves each piece once however many cells it falls
+    for (int lane = 0; lane < count; lane++) {
+        locking[lane] = 0;
+        if (gameOver[lane]) continue;
+        int gravity = gravityAt(scorers[lane].getLevel());
+        fall(lane, gravityCells(gravityCarried[lane], gravity));
+        if (!collides(lane, piece[lane], rotation[lane], x[lane], y[lane] - 1)) continue;
+        lockTicks[lane]++;
+        locking[lane] = lockTicks[lane] >= lockDelayTicks || lockResets[lane] >= maxLockResets;
+    }
+    resolveLocks();
+}
+
+bool BatchEngine::isGameOver(int lane) { return gameOver[lane]; }
+
+unsigned int BatchEngine::getScore(int lane) { return score[lane]; }
+
+int BatchEngine::getCombo(int lane) { return scorers[lane].getCombo(); }
+
+int BatchEngine::getLevel(int lane) { return scorers[lane].getLevel(); }
+
+ClearResult BatchEngine::getLastClear(int lane) { return lastClear[lane]; }
+
+std::uint32_t BatchEngine::getPieceCount(int lane) { return pieceCount[lane]; }
+
+Piece BatchEngine::getPiece(int lane) { return Piece(piece[lane]); }
+
+int BatchEngine::getRotation(int lane) { return rotation[lane]; }
+
+std::pair<int, int> BatchEngine::getOrigin(int lane) { return std::make_pair(x[lane], y[lane]); }
+
+bool BatchEngine::canHold(int lane) { return swappable[lane]; }
+
+int BatchEngine::getHold(int lane) { return hold[lane]; }
+
+std::array<Piece, Game::previewSize> BatchEngine::getUpcoming(int lane)
+{
+    std::array<Piece, Game::previewSize> pieces;
+    for (int i = 0; i < Game::previewSize; i++)
+        pieces[i] = Piece(upcoming[lane][i]);
+    return pieces;
+}
+
+std::array<std::uint16_t, HEIGHT> BatchEngine::getRows(int lane)
+{
+    std::array<std::uint16_t, HEIGHT> out;
+    for (int yy = 0; yy < HEIGHT; yy++)
+        out[yy] = (row(lane, yy) >> boardPadX) & ((1u << WIDTH) - 1);
+    return out;
+}
+
+bool BatchEngine::moveHorizontal(int lane, int dir)
+{
+    int d = dir > 0 ? 1 : -1;
+    if (collides(lane, piece[lane], rotation[lane], x[lane] + d, y[lane])) return false;
+    x[lane] += d;
+    set[lane] = 0;
+    moveKick[lane] = -1;
+    resetLockDelay(lane);
+    return true;
+}
+
+bool BatchEngine::rotate(int lane, Rotation r)
+{
+    const PieceShape& s = shapes[piece[lane]];
+    int from = rotation[lane];
+    int to = r == Clockwise ? (from + 1) % 4 : (from + 3) % 4;
+    for (int k = 0; k < 5; k++) {
+        auto kick = s.kicks[from][r][k];
+        if (!collides(lane, piece[lane], to, x[lane] + kick.first, y[lane] + kick.second)) {
+            x[lane] += kick.first;
+            y[lane] += kick.second;
+            rotation[lane] = to;
+            set[lane] = 0;
+            moveKick[lane] = k;
+            resetLockDelay(lane);
+            return true;
+        }
+    }
+    return false;
+}
+
+void BatchEngine::moveDownOrAdd(int lane)
+{
+    bool squareBelow = collides(lane, piece[lane], rotation[lane], x[lane], y[lane] - 1);
+    if (set[lane] && squareBelow) {
+        locking[lane] = 1;
+    } else if (!squareBelow) {
+        y[lane]--;
+        moveKick[lane] = -1;
+    }
+    if (collides(lane, piece[lane], rotation[lane], x[lane], y[lane] - 1)) set[lane] = 1;
+}
+
+int BatchEngine::dropDistance(int lane)
+{
+    int d = 0;
+    while (!collides(lane, piece[lane], rotation[lane], x[lane], y[lane] - d - 1))
+        d++;
+    return d;
+}
+
+int BatchEngine::fall(int lane, int cells)
+{
+    int d = 0;
+    while (d < cells && !collides(lane, piece[lane], rotation[lane], x[lane], y[lane] - d - 1))
+        d++;
+    if (d == 0) return 0;
+    y[lane] -= d;
+    moveKick[lane] = -1;
+    lockTicks[lane] = 0;
+    if (y[lane] < lowestY[lane]) {
+        lowestY[lane] = y[lane];
+        lockResets[lane] = 0;
+    }
+    return d;
+}
+
+void BatchEngine::resetLockDelay(int lane)
+{
+    if (lockTicks[lane] > 0 && lockResets[lane] < maxLockResets) {
+        lockTicks[lane] = 0;
+        lockResets[lane]++;
+    }
+}
+
+void BatchEngine::resetPiece(int lane)
+{
+    moveKick[lane] = -1;
+    lockTicks[lane] = 0;
+    lockResets[lane] = 0;
+    lowestY[lane] = INT8_MAX;
+    gravityCarried[lane] = 0;
+}
+
+void BatchEngine::holdPiece(int lane)
+{
+    if (!swappable[lane]) return;
+    if (hold[lane] >= 0) {
+        // the held piece keeps its set flag, like the Tetromino in Game's hold slot
+        int held = hold[lane];
+        hold[lane] = piece[lane];
+        piece[lane] = held;
+        std::swap(set[lane], holdSet[lane]);
+        const PieceShape& s = shapes[piece[lane]];
+        x[lane] = s.spawn.first;
+        y[lane] = s.spawn.second;
+        rotation[lane] = 0;
+        resetPiece(lane);
+    } else {
+        hold[lane] = piece[lane];
+        holdSet[lane] = set[lane];
+        nextPiece(lane);
+    }
+    swappable[lane] = 0;
+}
+
+void BatchEngine::resolveLocks()
+{
+    bool any = false;
+    for (int lane = 0; lane < count; lane++)
+        any |= locking[lane];
+    if (!any) return;
+
+    for (int lane = 0; lane < count; lane++) {
+        if (!locking[lane]) continue;
+        // corners are looked at before the piece is added, which fills none of them
+        spins[lane] = activeSpin(lane);
+        const PieceShape& s = shapes[piece[lane]];
+        int r = rotation[lane];
+        int shift = x[lane] + s.left[r] + boardPadX;
+        for (int i = 0; i < 4; i++) {
+            int yy = y[lane] + s.bottom[r] + i;
+            if (yy >= 0 && yy < HEIGHT) row(lane, yy) |= s.rows[r][i] << shift;
+        }
+        if (y[lane] + s.top[r] >= HEIGHT) gameOver[lane] = 1;
+    }
+
+    // full rows of every lane at once, a compare across each contiguous row of lanes
+    const int lanes = count;
+    std::uint32_t* __restrict full = fullRows.data();
+    std::fill_n(full, lanes, 0);
+    for (int yy = 0; yy < HEIGHT; yy++) {
+        const std::uint32_t* __restrict line = &rows[std::size_t(yy + boardPadY) * lanes];
+        for (int lane = 0; lane < lanes; lane++)
+            full[lane] |= std::uint32_t(line[lane] == fullRow) << yy;
+    }
+
+    for (int lane = 0; lane < count; lane++) {
+        if (!locking[lane] || gameOver[lane]) continue;
+        int lines = __builtin_popcount(full[lane]);
+        if (lines > 0) {
+            int to = 0;
+            for (int from = 0; from < HEIGHT; from++)
+                if (!(full[lane] >> from & 1)) row(lane, to++) = row(lane, from);
+            for (; to < HEIGHT; to++)
+                row(lane, to) = wallRow;
+        }
+        // the same test as Playfield::handleFullLines
+        bool perfectClear = lines > 0 && row(lane, 0) == wallRow;
+        lastClear[lane] = scorers[lane].lock(lines, Spin(spins[lane]), perfectClear);
+        score[lane] += lastClear[lane].points;
+        nextPiece(lane);
+        swappable[lane] = 1;
+    }
+}
+
+Spin BatchEngine::activeSpin(int lane)
+{
+    if (piece[lane] != T || moveKick[lane] < 0) return NoSpin;
+    int shift = x[lane] - 1 + boardPadX;
+    std::uint32_t above = row(lane, y[lane] + 1) >> shift;
+    std::uint32_t under = row(lane, y[lane] - 1) >> shift;
+    // bits 0 and 2 of the shifted rows are the columns left and right of the centre
+    int corners = (above >> 0 & 1) * TopLeft | (above >> 2 & 1) * TopRight
+                  | (under >> 2 & 1) * BottomRight | (under >> 0 & 1) * BottomLeft;
+    return spinFromCorners(rotation[lane], corners, moveKick[lane]);
+}
+
+void BatchEngine::spawn(int lane, Piece p)
+{
+    const PieceShape& s = shapes[p];
+    piece[lane] = p;
+    rotation[lane] = 0;
+    x[lane] = s.spawn.first;
+    y[lane] = s.spawn.second;
+    set[lane] = 0;
+    resetPiece(lane);
+}
+
+void BatchEngine::nextPiece(int lane)
+{
+    auto& queue = upcoming[lane];
+    spawn(lane, Piece(queue[0]));
+    std::copy(queue.begin() + 1, queue.end(), queue.begin());
+    queue[Game::previewSize - 1] = generators[lane].getNextPiece();
+    pieceCount[lane]++;
+}
@@ -0,0 +1,163 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "dimensions.hpp"
+#include "enums.hpp"
+#include "game.hpp"
+#include "generator.hpp"
+#include "scoring.hpp"
+#include "shapes.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// many games stepped together, for bulk simulation (self-play, reinforcement learning)
+//
+// instead of a Game per board, with pieces pointing at playfields, the boards are stored
+// as structure of arrays: row y of every board is contiguous (rows[y * lanes + lane]),
+// next to arrays of piece type, origin, rotation and so on. gravity, collision tests and
+// line clear detection run as loops across lanes with no branches on the data, and only the
+// rare lanes that actually lock or clear do any per-lane work. at -O3 the gravity and line
+// clear loops vectorise, the collision tests too where the target has gathers (-mavx2).
+// the loops take the lane count and arrays as restrict locals or arguments, through the
+// members a store to a byte array could be to the count, and nothing would vectorise
+//
+// the rules are the same as Game's, down to when a piece locks, so that a lane and a Game
+// with the same seed and inputs stay identical. only occupancy is kept, not colours
+
+class BatchEngine
+{
+public:
+    // one lane per seed, each lane plays the same game as Game(seed, mode, startLevel)
+    BatchEngine(const std::vector<unsigned int>& seeds, LockMode = StepLock, int startLevel = 1);
+
+    int lanes();
+
+    // start a new game in a lane, as if it had been constructed with this seed, at the start
+    // level of the engine or at the given one
+    void restart(int lane, unsigned int seed);
+    void restart(int lane, unsigned int seed, int startLevel);
+
+    // apply one action to each lane, actions has lanes() entries
+    void apply(const Action* actions);
+
+    // move the active piece of every lane down by one, like Game::gravity
+    void gravity();
+
+    // one tick of every lane of a DelayLock engine, like Game::tick
+    void tick();
+
+    // state of a lane
+    bool isGameOver(int lane);
+    unsigned int getScore(int lane);
+    int getCombo(int lane);
+    int getLevel(int lane);
+
+    // how the last lock of the lane scored
+    ClearResult getLastClear(int lane);
+    std::uint32_t getPieceCount(int lane);
+    Piece getPiece(int lane);
+    int getRotation(int lane);
+    std::pair<int, int> getOrigin(int lane);
+    bool canHold(int lane);
+
+    // -1 if nothing has been held yet
+    int getHold(int lane);
+
+    std::array<Piece, Game::previewSize> getUpcoming(int lane);
+
+    // occupancy of the board without the active piece, bit x of row y is column x
+    std::array<std::uint16_t, HEIGHT> getRows(int lane);
+
+private:
+    int count;
+    LockMode lockMode;
+    int startLevel;
+
+    // boardRows padded rows per lane, see shapes.hpp
+    std::vector<std::uint32_t> rows;
+
+    std::vector<std::uint8_t> piece;
+    std::vector<std::uint8_t> rotation;
+    std::vector<std::int8_t> x;
+    std::vector<std::int8_t> y;
+
+    // same meaning as Tetromino::set and Tetromino::lastMoveKick
+    std::vector<std::uint8_t> set;
+    std::vector<std::int8_t> moveKick;
+
+    // same meaning as the lock delay fields of Tetromino
+    std::vector<std::uint8_t> lockTicks;
+    std::vector<std::uint8_t> lockResets;
+    std::vector<std::int8_t> lowestY;
+    std::vector<int> gravityCarried;
+
+    std::vector<std::int8_t> hold;  // -1 for none
+    std::vector<std::uint8_t> holdSet;
+    std::vector<std::uint8_t> swappable;
+    std::vector<std::uint8_t> gameOver;
+
+    std::vector<unsigned int> score;
+    std::vector<Scorer> scorers;
+    std::vector<ClearResult> lastClear;
+    std::vector<std::uint32_t> pieceCount;
+    std::vector<std::array<std::uint8_t, Game::previewSize>> upcoming;
+    std::vector<RandomGenerator> generators;
+
+    // copied from shapeOf, so that the inner loops index a plain array
+    std::array<PieceShape, 7> shapes;
+
+    // the fields of shapes the collision test across lanes reads, flat by piece * 4 + rotation
+    // (and then row), so each is one gather
+    std::array<int, 28> shapeLeft;
+    std::array<int, 28> shapeBottom;
+    std::array<std::uint32_t, 112> shapeRows;
+
+    // scratch, per lane
+    std::vector<std::uint8_t> below;
+    std::vector<std::uint8_t> locking;
+    std::vector<std::uint8_t> spins;
+    std::vector<std::uint8_t> resting;
+    std::vector<std::uint32_t> fullRows;
+
+    std::uint32_t& row(int lane, int y) { return rows[(y + boardPadY) * count + lane]; }
+
+    // whether the piece would overlap something with its origin at px, py
+    bool collides(int lane, int p, int r, int px, int py)
+    {
+        const PieceShape& s = shapes[p];
+        int shift = px + s.left[r] + boardPadX;
+        int base = (py + s.bottom[r] + boardPadY) * count + lane;
+        std::uint32_t hit = 0;
+        for (int i = 0; i < 4; i++)
+            hit |= rows[base + i * count] & (s.rows[r][i] << shift);
+        return hit != 0;
+    }
+
+    // collides for every lane with the piece one row down, into out
+    void collidesBelow(std::uint8_t* __restrict out);
+
+    // the single lane versions of the Tetromino and Game operations
+    bool moveHorizontal(int lane, int dir);
+    bool rotate(int lane, Rotation);
+    void moveDownOrAdd(int lane);
+    int dropDistance(int lane);
+    int fall(int lane, int cells);
+    void resetLockDelay(int lane);
+    void resetPiece(int lane);
+    void holdPiece(int lane);
+
+    // the T-spin made by the piece of a lane that is locking, as Game::activeSpin
+    Spin activeSpin(int lane);
+
+    // add the pieces of all lanes marked in locking to their boards, then clear lines and
+    // spawn for every lane that locked
+    void resolveLocks();
+
+    void spawn(int lane, Piece);
+    void nextPiece(int lane);
+};
+
+#endif  // BATCH_H_
@@ -0,0 +1,92 @@
+#include "batch.hpp"
+#include "game.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+// throughput of BatchEngine against the same number of separate Game objects, fed the same
+// seeds and the same random inputs. finished games are restarted with a new seed on both
+// sides, so every step is a step of a live game
+//
+//   tetris-bench [-k boards] [-n steps] [-g gravity steps]
+
+int main(int argc, char* argv[])
+{
+    int boards = 4096;
+    int steps = 1000;
+    int gravitySteps = 4;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:n:g:")) != -1) {
+        switch (opt) {
+        case 'k': boards = std::atoi(optarg); break;
+        case 'n': steps = std::atoi(optarg); break;
+        case 'g': gravitySteps = std::atoi(optarg); break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-k boards] [-n steps] [-g gravity steps]"
+                      << std::endl;
+            return -1;
+        }
+    }
+    if (boards <= 0 || steps <= 0 || gravitySteps <= 0) return -1;
+
+    std::vector<unsigned int> seeds(boards);
+    for (int i = 0; i < boards; i++)
+        seeds[i] = i;
+
+    // mostly sideways moves and rotations, so that games last a while
+    std::mt19937 rng(1);
+    std::vector<Action> actions(std::size_t(boards) * steps);
+    for (auto& a : actions) {
+        int r = std::uniform_int_distribution<int>(0, 31)(rng);
+        a = r < 8 ? Action(r) : r < 19 ? ActionLeft : r < 30 ? ActionRight : ActionHarddrop;
+    }
+
+    std::vector<std::unique_ptr<Game>> games;
+    for (int i = 0; i < boards; i++)
+        games.push_back(std::make_unique<Game>(seeds[i]));
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+        const Action* step = &actions[std::size_t(s) * boards];
+        for (int i = 0; i < boards; i++) {
+            if (games[i]->isGameOver()) games[i] = std::make_unique<Game>(seeds[i] += boards);
+            Game& game = *games[i];
+            game.apply(step[i]);
+            if (s % gravitySteps == gravitySteps - 1 && !game.isGameOver()) game.gravity();
+        }
+    }
+    int gamesOver = 0;
+    for (int i = 0; i < boards; i++) {
+        gamesOver += (seeds[i] - i) / boards + games[i]->isGameOver();
+        seeds[i] = i;
+    }
+    std::chrono::duration<double> gameTime = std::chrono::steady_clock::now() - start;
+
+    BatchEngine batch(seeds);
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+        for (int i = 0; i < boards; i++)
+            if (batch.isGameOver(i)) batch.restart(i, seeds[i] += boards);
+        batch.apply(&actions[std::size_t(s) * boards]);
+        if (s % gravitySteps == gravitySteps - 1) batch.gravity();
+    }
+    std::chrono::duration<double> batchTime = std::chrono::steady_clock::now() - start;
+
+    int over = 0;
+    for (int i = 0; i < boards; i++)
+        over += (seeds[i] - i) / boards + batch.isGameOver(i);
+    if (over != gamesOver) std::cerr << "engines disagree on games over" << std::endl;
+
+    double total = double(boards) * steps;
+    std::cout << boards << " boards, " << steps << " steps, " << over << " games over"
+              << std::endl;
+    std::cout << "Game        " << total / gameTime.count() / 1e6 << "M steps/s" << std::endl;
+    std::cout << "BatchEngine " << total / batchTime.count() / 1e6 << "M steps/s ("
+              << gameTime.count() / batchTime.count() << "x)" << std::endl;
+    return 0;
+}
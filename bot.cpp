@@ -0,0 +1,123 @@
+#include "features.hpp"
+#include "game.hpp"
+#include "mcts.hpp"
+#include "movegen.hpp"
+#include "search.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+// a bot playing a game on its own, with the fewest inputs a player could use, from
+// planInputs. after every piece the game's board is checked against the board the bot
+// expected, so a placement the inputs did not reach shows up at once
+//
+// by default the lookahead search of search.hpp plays, -m switches to the Monte Carlo bot of
+// mcts.hpp. the budget is per piece and can be a fraction of a millisecond
+//
+//   tetris-bot [-m] [-j threads] [-b budget ms] [-d depth] [-w width] [-n pieces] [-s seed]
+
+int main(int argc, char* argv[])
+{
+    BotOptions options;
+    MctsOptions mctsOptions;
+    bool mcts = false;
+    double budget = options.budget;
+    int pieces = 200;
+    unsigned int seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "mj:b:d:w:n:s:")) != -1) {
+        switch (opt) {
+        case 'm': mcts = true; break;
+        case 'j': options.threads = std::atoi(optarg); break;
+        case 'b': budget = std::atof(optarg); break;
+        case 'd': options.maxDepth = mctsOptions.maxDepth = std::atoi(optarg); break;
+        case 'w': options.width = std::atoi(optarg); break;
+        case 'n': pieces = std::atoi(optarg); break;
+        case 's': seed = std::strtoul(optarg, nullptr, 10); break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-m] [-j threads] [-b budget ms] [-d depth]"
+                      << " [-w width] [-n pieces] [-s seed]" << std::endl;
+            return -1;
+        }
+    }
+    if (options.threads < 0 || budget <= 0 || options.maxDepth <= 0 || options.width <= 0
+        || pieces <= 0)
+        return -1;
+    options.budget = std::max(1l, std::lround(budget));
+    mctsOptions.budget = std::max(1l, std::lround(budget * 1000));
+    mctsOptions.seed = seed;
+
+    std::function<Decision(Game&)> think;
+    std::unique_ptr<Bot> bot;
+    std::unique_ptr<MctsBot> mctsBot;
+    if (mcts) {
+        mctsBot = std::make_unique<MctsBot>(mctsOptions);
+        think = [&](Game& game) { return mctsBot->think(game); };
+    } else {
+        bot = std::make_unique<Bot>(options);
+        think = [&](Game& game) { return bot->think(game); };
+    }
+    // no ticks, so nothing locks before the bot's harddrop
+    Game game(seed, DelayLock);
+    std::uint64_t nodes = 0;
+    long depths = 0;
+    int placed = 0;
+    int lines = 0;
+    long inputs = 0;
+    std::vector<double> times;
+    auto start = std::chrono::steady_clock::now();
+    while (placed < pieces && !game.isGameOver()) {
+        auto before = std::chrono::steady_clock::now();
+        Decision decision = think(game);
+        times.push_back(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count());
+        if (!decision.found) break;
+        nodes += decision.nodes;
+        depths += decision.depth;
+
+        FeatureBoard expected;
+        expected.reset(game.getPlayfield().getGrid());
+        auto path = planInputs(pad(expected), decision.placement);
+        if (path.empty()) {
+            std::cerr << "piece " << placed << ": no path to the chosen placement" << std::endl;
+            return 1;
+        }
+        if (decision.hold) game.hold();
+        for (Action action : path)
+            game.apply(action);
+        inputs += path.size() + decision.hold;
+        placed++;
+
+        expected.add(decision.placement.cells());
+        lines += expected.clearLines();
+        if (game.isGameOver()) break;
+        FeatureBoard actual;
+        actual.reset(game.getPlayfield().getGrid());
+        if (actual.getRows() != expected.getRows()) {
+            std::cerr << "piece " << placed << ": the board is not the one the bot expected"
+                      << std::endl;
+            return 1;
+        }
+    }
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    std::sort(times.begin(), times.end());
+    double p99 = times.empty() ? 0 : times[times.size() * 99 / 100];
+    double slowest = times.empty() ? 0 : times.back();
+
+    std::cout << placed << " pieces, " << lines << " lines, score "
+              << game.getScore() << (game.isGameOver() ? ", topped out" : "") << std::endl;
+    std::cout << "average depth " << double(depths) / std::max(placed, 1) << ", "
+              << nodes / time.count() << (mcts ? " playouts/s" : " nodes/s")
+              << ", decisions p99 " << p99 * 1000 << " ms, slowest " << slowest * 1000
+              << " ms, " << double(inputs) / std::max(placed, 1) << " inputs per piece"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,314 @@
+#include "broadcast.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int squareCount = WIDTH * HEIGHT;
+
+static_assert(squareCount <= 256, "a square's index is a byte");
+
+// frames written by one sendmsg, well under IOV_MAX
+constexpr int maxIovecs = 64;
+
+void put(std::vector<std::uint8_t>& out, std::uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        out.push_back(std::uint8_t(value >> (8 * i)));
+}
+
+std::uint64_t get(const std::uint8_t*& in, int bytes)
+{
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= std::uint64_t(*in++) << (8 * i);
+    return value;
+}
+
+Square squareAt(const Snapshot& snapshot, int index)
+{
+    return snapshot.grid[index / HEIGHT][index % HEIGHT];
+}
+
+// the header and everything but the squares
+std::vector<std::uint8_t> begin(FrameKind kind, const Snapshot& s, std::uint64_t base)
+{
+    std::vector<std::uint8_t> out;
+    out.reserve(frameHeaderBytes + frameStateBytes + 2 + 2 * 8);
+    put(out, 0, 4);
+    put(out, kind, 1);
+    put(out, s.tick, 8);
+    put(out, base, 8);
+    put(out, s.active, 1);
+    put(out, s.rotation, 1);
+    put(out, std::uint8_t(s.origin.first), 1);
+    put(out, std::uint8_t(s.origin.second), 1);
+    for (Piece piece : s.queue)
+        put(out, piece, 1);
+    put(out, std::uint8_t(s.hold), 1);
+    put(out, s.canHold, 1);
+    put(out, s.gameOver, 1);
+    put(out, s.level, 2);
+    put(out, s.score, 4);
+    assert(out.size() == frameHeaderBytes + frameStateBytes);
+    return out;
+}
+
+Frame finish(std::vector<std::uint8_t>& out)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = std::uint8_t(out.size() >> (8 * i));
+    return std::make_shared<const std::vector<std::uint8_t>>(std::move(out));
+}
+
+}  // namespace
+
+Frame encodeKeyframe(const Snapshot& snapshot)
+{
+    std::vector<std::uint8_t> out = begin(KeyFrame, snapshot, 0);
+    for (int i = 0; i < squareCount; i++)
+        out.push_back(squareAt(snapshot, i));
+    return finish(out);
+}
+
+Frame encodeDelta(const Snapshot& from, const Snapshot& to)
+{
+    std::vector<std::uint8_t> out = begin(DeltaFrame, to, from.tick);
+    // the count goes in once the squares are known
+    std::size_t count = out.size();
+    put(out, 0, 2);
+    int changed = 0;
+    for (int i = 0; i < squareCount; i++) {
+        if (squareAt(from, i) == squareAt(to, i)) continue;
+        out.push_back(i);
+        out.push_back(squareAt(to, i));
+        changed++;
+    }
+    out[count] = std::uint8_t(changed);
+    out[count + 1] = std::uint8_t(changed >> 8);
+
+    bool same = changed == 0 && from.active == to.active && from.rotation == to.rotation
+                && from.origin == to.origin && from.queue == to.queue && from.hold == to.hold
+                && from.canHold == to.canHold && from.gameOver == to.gameOver
+                && from.level == to.level && from.score == to.score;
+    if (same) return nullptr;
+    return finish(out);
+}
+
+bool SpectatorView::feed(const std::uint8_t* bytes, std::size_t size)
+{
+    if (broken) return false;
+    buffered.insert(buffered.end(), bytes, bytes + size);
+    std::size_t used = 0;
+    while (buffered.size() - used >= 4) {
+        const std::uint8_t* at = buffered.data() + used;
+        std::size_t length = get(at, 4);
+        if (length < frameHeaderBytes + frameStateBytes) {
+            broken = true;
+            break;
+        }
+        if (buffered.size() - used < length) break;
+        if (!apply(buffered.data() + used, length)) {
+            broken = true;
+            break;
+        }
+        used += length;
+    }
+    buffered.erase(buffered.begin(), buffered.begin() + used);
+    return !broken;
+}
+
+bool SpectatorView::apply(const std::uint8_t* frame, std::size_t length)
+{
+    const std::uint8_t* at = frame + 4;
+    FrameKind kind = FrameKind(get(at, 1));
+    std::uint64_t tick = get(at, 8);
+    std::uint64_t base = get(at, 8);
+    if (kind != KeyFrame && kind != DeltaFrame) return false;
+    // a delta only follows the frame it was made from
+    if (kind == DeltaFrame && (!synced || base != snapshot.tick)) return false;
+
+    Snapshot next = snapshot;
+    next.tick = tick;
+    next.active = Piece(get(at, 1));
+    next.rotation = get(at, 1);
+    next.origin.first = std::int8_t(get(at, 1));
+    next.origin.second = std::int8_t(get(at, 1));
+    for (Piece& piece : next.queue)
+        piece = Piece(get(at, 1));
+    next.hold = std::int8_t(get(at, 1));
+    next.canHold = get(at, 1);
+    next.gameOver = get(at, 1);
+    next.level = get(at, 2);
+    next.score = get(at, 4);
+
+    const std::uint8_t* end = frame + length;
+    if (kind == KeyFrame) {
+        if (end - at != squareCount) return false;
+        for (int i = 0; i < squareCount; i++)
+            next.grid[i / HEIGHT][i % HEIGHT] = Square(*at++);
+        keyframes++;
+    } else {
+        if (end - at < 2) return false;
+        std::size_t changed = get(at, 2);
+        if (std::size_t(end - at) != 2 * changed) return false;
+        for (std::size_t i = 0; i < changed; i++) {
+            int index = *at++;
+            if (index >= squareCount) return false;
+            next.grid[index / HEIGHT][index % HEIGHT] = Square(*at++);
+        }
+    }
+    snapshot = next;
+    synced = true;
+    frames++;
+    return true;
+}
+
+bool SpectatorView::isSynced() { return synced; }
+
+const Snapshot& SpectatorView::getSnapshot() { return snapshot; }
+
+std::uint64_t SpectatorView::getFrames() { return frames; }
+
+std::uint64_t SpectatorView::getKeyframes() { return keyframes; }
+
+Broadcaster::Broadcaster(BroadcastOptions o) : options(o)
+{
+    options.keyframeInterval = std::max(options.keyframeInterval, 1);
+}
+
+Broadcaster::~Broadcaster()
+{
+    for (Spectator& spectator : spectators)
+        close(spectator.fd);
+}
+
+void Broadcaster::publish(const Snapshot& snapshot)
+{
+    Frame delta;
+    if (started) {
+        delta = encodeDelta(last, snapshot);
+        if (!delta) return;
+        stats.encodedBytes += delta->size();
+    }
+    // spectators already watching go on with deltas, only the tail starts from the keyframe
+    Frame live = delta;
+    if (!started || int(tail.size()) > options.keyframeInterval) {
+        Frame keyframe = encodeKeyframe(snapshot);
+        stats.keyframes++;
+        stats.encodedBytes += keyframe->size();
+        tail.assign(1, keyframe);
+        if (!live) live = keyframe;
+    } else {
+        tail.push_back(delta);
+    }
+    last = snapshot;
+    started = true;
+    stats.frames++;
+
+    for (std::size_t i = 0; i < spectators.size();) {
+        if (enqueue(spectators[i], live))
+            i++;
+        else
+            drop(i);
+    }
+}
+
+void Broadcaster::subscribe(int fd)
+{
+    Spectator spectator;
+    spectator.fd = fd;
+    for (const Frame& frame : tail) {
+        spectator.queue.push_back(frame);
+        spectator.queued += frame->size();
+    }
+    spectators.push_back(std::move(spectator));
+}
+
+void Broadcaster::flush()
+{
+    for (std::size_t i = 0; i < spectators.size();) {
+        if (spectators[i].queue.empty() || write(spectators[i]))
+            i++;
+        else
+            drop(i);
+    }
+}
+
+std::size_t Broadcaster::getSpectators() { return spectators.size(); }
+
+const BroadcastStats& Broadcaster::getStats() { return stats; }
+
+bool Broadcaster::enqueue(Spectator& spectator, const Frame& frame)
+{
+    spectator.queue.push_back(frame);
+    spectator.queued += frame->size();
+    if (spectator.queued <= options.maxQueued) return true;
+    if (options.dropSlow) return false;
+
+    // the frame being written has to be finished, or the stream would lose its place
+    stats.resyncs++;
+    std::size_t keep = spectator.offset > 0 ? 1 : 0;
+    spectator.queue.resize(keep);
+    spectator.queued = keep ? spectator.queue.front()->size() - spectator.offset : 0;
+    for (const Frame& caught : tail) {
+        spectator.queue.push_back(caught);
+        spectator.queued += caught->size();
+    }
+    // a tail bigger than the bound would start it again on every frame
+    return spectator.queued <= options.maxQueued;
+}
+
+bool Broadcaster::write(Spectator& spectator)
+{
+    while (!spectator.queue.empty()) {
+        iovec iovecs[maxIovecs];
+        int count = 0;
+        std::size_t total = 0;
+        std::size_t offset = spectator.offset;
+        for (const Frame& frame : spectator.queue) {
+            if (count == maxIovecs) break;
+            iovecs[count].iov_base = const_cast<std::uint8_t*>(frame->data() + offset);
+            iovecs[count].iov_len = frame->size() - offset;
+            total += iovecs[count++].iov_len;
+            offset = 0;
+        }
+        msghdr message = {};
+        message.msg_iov = iovecs;
+        message.msg_iovlen = count;
+        // a spectator that went away must not raise SIGPIPE in the server
+        ssize_t sent = sendmsg(spectator.fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+        stats.writes++;
+        if (sent < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        stats.sentBytes += sent;
+        spectator.queued -= sent;
+
+        std::size_t left = sent;
+        while (left > 0) {
+            std::size_t rest = spectator.queue.front()->size() - spectator.offset;
+            if (left < rest) {
+                spectator.offset += left;
+                break;
+            }
+            left -= rest;
+            spectator.offset = 0;
+            spectator.queue.pop_front();
+        }
+        // the socket is full
+        if (std::size_t(sent) < total) break;
+    }
+    return true;
+}
+
+void Broadcaster::drop(std::size_t index)
+{
+    close(spectators[index].fd);
+    spectators[index] = std::move(spectators.back());
+    spectators.pop_back();
+    stats.dropped++;
+}
@@ -0,0 +1,165 @@
+#ifndef BROADCAST_H_
+#define BROADCAST_H_
+
+#include "snapshot.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// a match sent to many spectators at once
+//
+// each frame a match publishes is encoded once, as what changed since the frame before, into
+// a buffer that never changes after and is shared by every spectator through a shared_ptr. a
+// spectator only holds a queue of pointers to frames and how much of the first one it has
+// been sent, and a flush writes its queue with one sendmsg, an iovec per frame, so the cost
+// per spectator is the syscall and never encoding. every so many frames a keyframe of the
+// whole state starts a new tail of changes, and a spectator joining late is sent the last
+// keyframe and the tail after it, which brings it up to date
+//
+// a spectator whose queue grows past a bound is slow. its queue is thrown away and it is sent
+// the keyframe and tail again, skipping what it missed, or it is dropped, as the options say,
+// so a slow reader never holds more than the bound and a tail. a Broadcaster is used from one
+// thread, like a Scheduler
+//
+// a frame is its length in bytes (u32, counting the whole frame), its FrameKind (u8), its
+// tick and the tick of the frame it changes (u64 each, 0 for a keyframe), then the active
+// piece, its rotation and origin, the queue, hold, whether it can hold, whether the game is
+// over (u8 each, hold -1 for none), the level (u16) and the score (u32), then the squares of
+// the grid with the active piece drawn in: in a keyframe every one of them (u8 each, column
+// by column from the bottom), in a delta the number that changed (u16) followed by each one's
+// index in that order and its Square (u8 each). numbers are little endian
+
+enum FrameKind : std::uint8_t { KeyFrame, DeltaFrame };
+
+// bytes of every frame before the squares: the length, kind and ticks, then the active piece,
+// its rotation and origin, the queue, hold, whether it can hold, whether the game is over,
+// the level and the score. a delta with no squares changed is these and its count
+constexpr std::size_t frameHeaderBytes = 4 + 1 + 8 + 8;
+constexpr std::size_t frameStateBytes = 4 + Game::previewSize + 3 + 2 + 4;
+
+// an encoded frame, shared by everyone it is queued for
+typedef std::shared_ptr<const std::vector<std::uint8_t>> Frame;
+
+Frame encodeKeyframe(const Snapshot&);
+
+// the changes from one snapshot to a later one, nullptr if nothing but the tick changed
+Frame encodeDelta(const Snapshot& from, const Snapshot& to);
+
+// a match as a spectator puts it back together from the bytes of the stream
+class SpectatorView
+{
+public:
+    // bytes as they were read, which may end or start in the middle of a frame. false once
+    // something that is not a frame, or a delta for a frame that did not come, was read
+    bool feed(const std::uint8_t*, std::size_t);
+
+    // whether a keyframe has come in, after which the snapshot is the match at its tick
+    bool isSynced();
+
+    const Snapshot& getSnapshot();
+
+    std::uint64_t getFrames();
+    std::uint64_t getKeyframes();
+
+private:
+    Snapshot snapshot;
+    bool synced = false;
+    bool broken = false;
+    std::uint64_t frames = 0;
+    std::uint64_t keyframes = 0;
+
+    // bytes read that do not make a whole frame yet
+    std::vector<std::uint8_t> buffered;
+
+    bool apply(const std::uint8_t*, std::size_t);
+};
+
+struct BroadcastOptions
+{
+    // frames between keyframes, which bounds the tail a late joiner is sent
+    int keyframeInterval = 60;
+
+    // bytes queued for a spectator before it counts as slow
+    std::size_t maxQueued = std::size_t(64) << 10;
+
+    // drop slow spectators, instead of starting them again from the last keyframe
+    bool dropSlow = false;
+};
+
+struct BroadcastStats
+{
+    // frames published, keyframes encoded for the tail, and the bytes of both encoded
+    std::uint64_t frames = 0;
+    std::uint64_t keyframes = 0;
+    std::uint64_t encodedBytes = 0;
+
+    // sendmsg calls and the bytes they wrote
+    std::uint64_t writes = 0;
+    std::uint64_t sentBytes = 0;
+
+    // slow spectators started again from a keyframe, and spectators dropped for any reason
+    std::uint64_t resyncs = 0;
+    std::uint64_t dropped = 0;
+};
+
+class Broadcaster
+{
+public:
+    explicit Broadcaster(BroadcastOptions = BroadcastOptions());
+
+    // closes the sockets of the spectators left
+    ~Broadcaster();
+
+    Broadcaster(const Broadcaster&) = delete;
+    Broadcaster& operator=(const Broadcaster&) = delete;
+
+    // encode the match as of a snapshot and queue it for every spectator. nothing is queued
+    // if nothing changed since the last one
+    void publish(const Snapshot&);
+
+    // a spectator's stream socket, which the broadcaster owns from now on and closes when it
+    // drops the spectator. it is queued the last keyframe and the tail after it
+    void subscribe(int fd);
+
+    // write what every spectator has queued, as much as each socket takes without blocking.
+    // spectators whose socket failed or closed are dropped
+    void flush();
+
+    std::size_t getSpectators();
+    const BroadcastStats& getStats();
+
+private:
+    struct Spectator
+    {
+        int fd = -1;
+        std::deque<Frame> queue;
+
+        // bytes of the first frame already written, and bytes of the queue not yet written
+        std::size_t offset = 0;
+        std::size_t queued = 0;
+    };
+
+    BroadcastOptions options;
+    std::vector<Spectator> spectators;
+    BroadcastStats stats;
+
+    // the last snapshot published, which the next delta is from
+    Snapshot last;
+    bool started = false;
+
+    // the last keyframe and every delta since, what a spectator needs to catch up
+    std::vector<Frame> tail;
+
+    // queue a frame, false if that makes the spectator slow and it is to be dropped
+    bool enqueue(Spectator&, const Frame&);
+
+    // write as much of the queue as the socket takes, false if it failed
+    bool write(Spectator&);
+
+    void drop(std::size_t index);
+};
+
+#endif  // BROADCAST_H_
@@ -16,4 +16,27 @@ enum Square {  // standard tetromino colours and empty square
 
 enum Piece { I, J, L, O, S, T, Z };
 
+// one input to a game, for headless engines and bots
+enum Action {
+    ActionNone,
+    ActionLeft,
+    ActionRight,
+    ActionClockwise,
+    ActionCounterClockwise,
+    ActionSoftdrop,
+    ActionHarddrop,
+    ActionHold
+};
+
+// when a piece resting on the stack locks
+enum LockMode {
+    // on the second step down it can not make, whether from gravity or a softdrop, unless it
+    // moved or rotated in between
+    StepLock,
+
+    // after lockDelayTicks ticks on the stack, with gravity from the level curve, see
+    // timing.hpp. softdrops never lock and harddrops lock at once
+    DelayLock
+};
+
 #endif  // ENUMS_H_
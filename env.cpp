@@ -0,0 +1,236 @@
+#include "tetris_env.h"
+
+#include "game.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static_assert(TETRIS_ENV_WIDTH == WIDTH && TETRIS_ENV_HEIGHT == HEIGHT,
+  "tetris_env.h must be kept in sync with dimensions.hpp");
+static_assert(TETRIS_ENV_PREVIEW == Game::previewSize,
+  "tetris_env.h must be kept in sync with Game::previewSize");
+static_assert(WIDTH <= 16, "rows are 16 bit masks");
+static_assert(sizeof(tetris_obs) == 64, "tetris_obs is part of the abi");
+
+namespace {
+
+// splitmix64, so that neighbouring sessions and episodes get unrelated seeds
+std::uint64_t mix(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+}  // namespace
+
+struct tetris_env
+{
+    int gravitySteps;
+    std::uint64_t seed;
+
+    std::vector<std::unique_ptr<Game>> games;
+    std::vector<std::uint32_t> episodes;
+    std::vector<int> sinceGravity;
+
+    // arguments of the batch being run, read by every worker
+    bool resetting;
+    const std::int32_t* actions;
+    tetris_obs* obs;
+    float* rewards;
+    std::uint8_t* dones;
+
+    // workers wait for generation to change, run their share of the sessions and count
+    // pending down, the last one to finish wakes the caller
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startBatch;
+    std::condition_variable batchDone;
+    std::uint64_t generation = 0;
+    int pending = 0;
+    bool stopping = false;
+
+    void startGame(int i)
+    {
+        unsigned int gameSeed = mix(seed ^ mix(i) ^ (mix(episodes[i]) << 1));
+        games[i] = std::make_unique<Game>(gameSeed);
+        sinceGravity[i] = 0;
+    }
+
+    void observe(int i, tetris_obs& o)
+    {
+        Game& game = *games[i];
+        auto grid = game.getPlayfield().getGrid();
+        for (int y = 0; y < HEIGHT; y++) {
+            std::uint16_t row = 0;
+            for (int x = 0; x < WIDTH; x++)
+                row |= std::uint16_t(grid[x][y] != Empty) << x;
+            o.rows[y] = row;
+        }
+        Tetromino& active = game.getActivePiece();
+        auto origin = active.getOrigin();
+        o.piece = active.getPiece();
+        o.rotation = active.getRotation();
+        o.x = origin.first;
+        o.y = origin.second;
+        Tetromino* carry = game.getCarryPiece();
+        o.hold = carry ? carry->getPiece() : -1;
+        o.can_hold = game.canHold();
+        int q = 0;
+        for (auto& piece : game.getUpcoming())
+            o.queue[q++] = piece->getPiece();
+        o.padding[0] = o.padding[1] = 0;
+        o.score = game.getScore();
+        o.pieces = game.getPieceCount();
+    }
+
+    void step(int i)
+    {
+        Game& game = *games[i];
+        unsigned int before = game.getScore();
+        switch (actions[i]) {
+        case TETRIS_ACTION_LEFT: game.moveHorizontal(-1); break;
+        case TETRIS_ACTION_RIGHT: game.moveHorizontal(1); break;
+        case TETRIS_ACTION_ROTATE_CW: game.rotate(Clockwise); break;
+        case TETRIS_ACTION_ROTATE_CCW: game.rotate(CounterClockwise); break;
+        case TETRIS_ACTION_SOFT_DROP: game.softdrop(); break;
+        case TETRIS_ACTION_HARD_DROP: game.harddrop(); break;
+        case TETRIS_ACTION_HOLD: game.hold(); break;
+        default: break;
+        }
+        if (!game.isGameOver() && ++sinceGravity[i] >= gravitySteps) {
+            sinceGravity[i] = 0;
+            game.gravity();
+        }
+        if (rewards) rewards[i] = float(game.getScore() - before);
+        bool over = game.isGameOver();
+        if (dones) dones[i] = over;
+        if (over) {
+            episodes[i]++;
+            startGame(i);
+        }
+    }
+
+    // sessions [begin, end) of the current batch
+    void run(int begin, int end)
+    {
+        for (int i = begin; i < end; i++) {
+            if (resetting) {
+                episodes[i] = 0;
+                startGame(i);
+            } else {
+                step(i);
+            }
+            if (obs) observe(i, obs[i]);
+        }
+    }
+
+    int chunkBegin(int t)
+    {
+        return int(std::int64_t(games.size()) * t / (workers.size() + 1));
+    }
+
+    void worker(int t)
+    {
+        std::uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                startBatch.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            run(chunkBegin(t), chunkBegin(t + 1));
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) batchDone.notify_one();
+        }
+    }
+
+    void runBatch()
+    {
+        if (workers.empty()) {
+            run(0, games.size());
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation++;
+            pending = workers.size();
+        }
+        startBatch.notify_all();
+        // the calling thread takes the first share
+        run(0, chunkBegin(1));
+        std::unique_lock<std::mutex> lock(mutex);
+        batchDone.wait(lock, [&] { return pending == 0; });
+    }
+};
+
+extern "C" {
+
+uint32_t tetris_env_abi_version(void) { return TETRIS_ENV_ABI_VERSION; }
+
+tetris_env* tetris_env_create(int sessions, int gravity_steps, uint64_t seed, int threads)
+{
+    if (sessions <= 0 || gravity_steps <= 0 || threads < 0) return nullptr;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, sessions);
+
+    tetris_env* env = new tetris_env;
+    env->gravitySteps = gravity_steps;
+    env->seed = seed;
+    env->games.resize(sessions);
+    env->episodes.assign(sessions, 0);
+    env->sinceGravity.assign(sessions, 0);
+    env->resetting = true;
+    env->actions = nullptr;
+    env->obs = nullptr;
+    env->rewards = nullptr;
+    env->dones = nullptr;
+    for (int t = 1; t < threads; t++)
+        env->workers.emplace_back(&tetris_env::worker, env, t);
+    env->runBatch();
+    return env;
+}
+
+void tetris_env_destroy(tetris_env* env)
+{
+    if (!env) return;
+    {
+        std::lock_guard<std::mutex> lock(env->mutex);
+        env->stopping = true;
+    }
+    env->startBatch.notify_all();
+    for (auto& w : env->workers)
+        w.join();
+    delete env;
+}
+
+int tetris_env_sessions(const tetris_env* env) { return env->games.size(); }
+
+void tetris_env_reset(tetris_env* env, tetris_obs* obs)
+{
+    env->resetting = true;
+    env->actions = nullptr;
+    env->obs = obs;
+    env->rewards = nullptr;
+    env->dones = nullptr;
+    env->runBatch();
+}
+
+void tetris_env_step_batch(tetris_env* env, const int32_t* actions, tetris_obs* obs,
+  float* rewards, uint8_t* dones)
+{
+    env->resetting = false;
+    env->actions = actions;
+    env->obs = obs;
+    env->rewards = rewards;
+    env->dones = dones;
+    env->runBatch();
+}
+
+}  // extern "C"
@@ -0,0 +1,108 @@
+#include "eventlog.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+EventLog::EventLog(const std::string& path)
+{
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "could not open event log " << path << std::endl;
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0) {
+        GameEvent header = {};
+        header.game = magic;
+        header.sequence = version;
+        header.pieceCount = sizeof(GameEvent);
+        header.type = HeaderEvent;
+        write(&header, sizeof(header));
+    }
+    nextGame = std::uint64_t(getpid()) << 32;
+}
+
+EventLog::~EventLog()
+{
+    if (fd >= 0) close(fd);
+}
+
+bool EventLog::isOpen() { return fd >= 0; }
+
+std::uint64_t EventLog::newGame() { return nextGame.fetch_add(1, std::memory_order_relaxed); }
+
+void EventLog::write(const void* data, std::size_t size)
+{
+    if (fd < 0) return;
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "could not write to event log" << std::endl;
+            return;
+        }
+        p += n;
+        size -= n;
+    }
+}
+
+EventLog::Writer::Writer(EventLog& l, std::size_t capacity) : log(l), buffer(capacity) {}
+
+EventLog::Writer::~Writer() { flush(); }
+
+void EventLog::Writer::flush()
+{
+    if (count == 0) return;
+    log.write(buffer.data(), count * sizeof(GameEvent));
+    count = 0;
+}
+
+EventLogReader::EventLogReader(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || std::size_t(st.st_size) < sizeof(GameEvent)) {
+        close(fd);
+        return;
+    }
+    mappingSize = st.st_size;
+    mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return;
+    }
+    // the records are read front to back, let the kernel read ahead aggressively
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    madvise(mapping, mappingSize, MADV_WILLNEED);
+
+    auto header = static_cast<const GameEvent*>(mapping);
+    if (header->type != HeaderEvent || header->game != EventLog::magic
+        || header->sequence < 1 || header->sequence > EventLog::version
+        || header->pieceCount != sizeof(GameEvent)) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        return;
+    }
+    first = header + 1;
+    count = mappingSize / sizeof(GameEvent) - 1;
+}
+
+EventLogReader::~EventLogReader()
+{
+    if (mapping) munmap(mapping, mappingSize);
+}
+
+bool EventLogReader::isOpen() { return mapping != nullptr; }
+
+const GameEvent* EventLogReader::begin() { return first; }
+
+const GameEvent* EventLogReader::end() { return first + count; }
+
+std::size_t EventLogReader::size() { return count; }
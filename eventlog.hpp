@@ -0,0 +1,141 @@
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// binary log of everything that happens in a game, for analytics
+//
+// the log is a file of fixed size records, the first of which is a header. games append
+// through a Writer, which is a buffer owned by one thread, so appending is a plain store
+// with no locks or atomics. a full buffer goes to the file in one write() on a descriptor
+// opened with O_APPEND, so buffers from different threads (or processes) never interleave
+// inside a record. EventLogReader maps the file and hands out the records as an array
+
+enum EventType : std::uint8_t {
+    HeaderEvent,  // first record of the file, see EventLog
+    SpawnEvent,  // a piece entered the playfield
+    MoveEvent,  // the active piece moved left, right or down by one
+    RotateEvent,  // a rotation was attempted, kick is the kick test used or -1 if it failed
+    HoldEvent,  // the active piece was swapped with the held piece
+    LockEvent,  // the active piece was added to the playfield
+    ClearEvent,  // lines were cleared or a T-spin locked, with how it scored
+    GameOverEvent  // a piece locked above the playfield
+};
+
+struct GameEvent
+{
+    // id of the game, unique within a log
+    std::uint64_t game;
+
+    // position of the event within its game, and how many pieces have spawned so far
+    std::uint32_t sequence;
+    std::uint32_t pieceCount;
+
+    std::uint8_t type;
+
+    // the active piece, its origin (see Tetromino::getOrigin) and rotation identifier
+    std::uint8_t piece;
+    std::int8_t x;
+    std::int8_t y;
+    std::uint8_t rotation;
+
+    std::int8_t kick;
+    std::uint8_t lines;
+    std::uint8_t combo;
+    std::int32_t scoreDelta;
+
+    // for clears: the Spin (see scoring.hpp), ClearFlags, garbage sent and the level the
+    // clear was scored at. all 0 in version 1 logs
+    std::uint8_t spin;
+    std::uint8_t flags;
+    std::uint8_t garbage;
+    std::uint8_t level;
+};
+
+enum ClearFlags : std::uint8_t { PerfectClearFlag = 1, BackToBackFlag = 2 };
+
+static_assert(sizeof(GameEvent) == 32, "event records must stay 32 bytes");
+
+class EventLog
+{
+public:
+    // "TETRISEV", stored in the game field of the header record
+    static constexpr std::uint64_t magic = 0x5645534952544554ull;
+    // version 2 added the clear details, older logs can still be read
+    static constexpr std::uint32_t version = 2;
+
+    // open the file for appending, creating it with a header if it is empty
+    EventLog(const std::string& path);
+    ~EventLog();
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    bool isOpen();
+
+    // a fresh id for a game about to write to this log
+    std::uint64_t newGame();
+
+    // per-thread buffer of events, flushed to the log when full and when destroyed
+    class Writer
+    {
+    public:
+        Writer(EventLog&, std::size_t capacity = 4096);
+        ~Writer();
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        void append(const GameEvent& e)
+        {
+            buffer[count++] = e;
+            if (count == buffer.size()) flush();
+        }
+
+        void flush();
+
+    private:
+        EventLog& log;
+        std::vector<GameEvent> buffer;
+        std::size_t count = 0;
+    };
+
+private:
+    int fd;
+
+    // games get ids from the process id and this counter, so that several processes can
+    // share a log
+    std::atomic<std::uint64_t> nextGame{0};
+
+    void write(const void*, std::size_t);
+};
+
+class EventLogReader
+{
+public:
+    // map the file read only, isOpen() is false if it is missing or not an event log
+    EventLogReader(const std::string& path);
+    ~EventLogReader();
+
+    EventLogReader(const EventLogReader&) = delete;
+    EventLogReader& operator=(const EventLogReader&) = delete;
+
+    bool isOpen();
+
+    // the records after the header, a trailing partial record is ignored
+    const GameEvent* begin();
+    const GameEvent* end();
+    std::size_t size();
+
+private:
+    void* mapping = nullptr;
+    std::size_t mappingSize = 0;
+    const GameEvent* first = nullptr;
+    std::size_t count = 0;
+};
+
+#endif  // EVENTLOG_H_
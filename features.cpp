@@ -0,0 +1,213 @@
+#include "features.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+static_assert(WIDTH >= 2 && WIDTH <= 30, "rows must fit a mask with a bit for each wall");
+static_assert(HEIGHT <= 31, "columns must fit a mask");
+
+namespace {
+
+const std::uint32_t fullRow = (1u << WIDTH) - 1;
+const std::uint32_t allRows = (1u << HEIGHT) - 1;
+
+int height(std::uint32_t column) { return column ? 32 - __builtin_clz(column) : 0; }
+
+int holes(std::uint32_t column) { return height(column) - __builtin_popcount(column); }
+
+int columnTransitions(std::uint32_t column)
+{
+    // each row against the one below it, the floor below row 0 is full
+    return __builtin_popcount((column ^ (column << 1 | 1)) & allRows);
+}
+
+int rowTransitions(std::uint32_t row)
+{
+    // the walls become bits 0 and WIDTH + 1, then each bit against the next
+    std::uint32_t walled = row << 1 | 1 | 1u << (WIDTH + 1);
+    return __builtin_popcount((walled ^ walled >> 1) & ((1u << (WIDTH + 1)) - 1));
+}
+
+int wellDepth(const std::array<int, WIDTH>& heights, int x)
+{
+    int left = x > 0 ? heights[x - 1] : HEIGHT;
+    int right = x < WIDTH - 1 ? heights[x + 1] : HEIGHT;
+    return std::max(std::min(left, right) - heights[x], 0);
+}
+
+// wells of the columns from first to last
+int wells(const std::array<int, WIDTH>& heights, int first, int last)
+{
+    int sum = 0;
+    for (int x = first; x <= last; x++)
+        sum += wellDepth(heights, x);
+    return sum;
+}
+
+// bumpiness between the columns from first to last
+int bumpiness(const std::array<int, WIDTH>& heights, int first, int last)
+{
+    int sum = 0;
+    for (int x = first; x < last; x++)
+        sum += std::abs(heights[x] - heights[x + 1]);
+    return sum;
+}
+
+BoardFeatures measure(const FeatureBoard::Columns& columns, const FeatureBoard::Rows& rows)
+{
+    BoardFeatures f;
+    for (int x = 0; x < WIDTH; x++) {
+        f.heights[x] = height(columns[x]);
+        f.maxHeight = std::max(f.maxHeight, f.heights[x]);
+        f.aggregateHeight += f.heights[x];
+        f.holes += holes(columns[x]);
+        f.columnTransitions += columnTransitions(columns[x]);
+    }
+    for (int y = 0; y < HEIGHT; y++)
+        f.rowTransitions += rowTransitions(rows[y]);
+    f.wells = wells(f.heights, 0, WIDTH - 1);
+    f.bumpiness = bumpiness(f.heights, 0, WIDTH - 1);
+    return f;
+}
+
+// set the squares in the masks and bring f up to date with them, touching only the terms of
+// the columns and rows that change
+BoardFeatures place(const FeatureBoard::Squares& squares, FeatureBoard::Columns& columns,
+                    FeatureBoard::Rows& rows, BoardFeatures f)
+{
+    f.linesCleared = 0;
+    f.toppedOut = false;
+    int lo = WIDTH, hi = -1;
+    std::uint32_t touchedRows = 0;
+    for (auto coord : squares) {
+        int x = coord.first, y = coord.second;
+        if (y >= HEIGHT) {
+            f.toppedOut = true;
+        } else if (x >= 0 && x < WIDTH && y >= 0) {
+            lo = std::min(lo, x);
+            hi = std::max(hi, x);
+            touchedRows |= 1u << y;
+        }
+    }
+    if (hi < 0) return f;
+
+    // a changed height moves the wells and bumpiness of the columns either side too
+    int first = std::max(lo - 1, 0), last = std::min(hi + 1, WIDTH - 1);
+    f.wells -= wells(f.heights, first, last);
+    f.bumpiness -= bumpiness(f.heights, first, last);
+    for (int x = lo; x <= hi; x++) {
+        f.aggregateHeight -= f.heights[x];
+        f.holes -= holes(columns[x]);
+        f.columnTransitions -= columnTransitions(columns[x]);
+    }
+    for (std::uint32_t m = touchedRows; m; m &= m - 1)
+        f.rowTransitions -= rowTransitions(rows[__builtin_ctz(m)]);
+
+    for (auto coord : squares) {
+        int x = coord.first, y = coord.second;
+        if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) continue;
+        columns[x] |= 1u << y;
+        rows[y] |= 1u << x;
+    }
+
+    for (int x = lo; x <= hi; x++) {
+        f.heights[x] = height(columns[x]);
+        f.maxHeight = std::max(f.maxHeight, f.heights[x]);
+        f.aggregateHeight += f.heights[x];
+        f.holes += holes(columns[x]);
+        f.columnTransitions += columnTransitions(columns[x]);
+    }
+    for (std::uint32_t m = touchedRows; m; m &= m - 1)
+        f.rowTransitions += rowTransitions(rows[__builtin_ctz(m)]);
+    f.wells += wells(f.heights, first, last);
+    f.bumpiness += bumpiness(f.heights, first, last);
+    return f;
+}
+
+// rows a placement touches, the only ones it can fill
+std::uint32_t rowsOf(const FeatureBoard::Squares& squares)
+{
+    std::uint32_t touched = 0;
+    for (auto coord : squares) {
+        if (coord.first >= 0 && coord.first < WIDTH && coord.second >= 0 && coord.second < HEIGHT)
+            touched |= 1u << coord.second;
+    }
+    return touched;
+}
+
+// take the full rows among the candidates out of the masks, returning how many there were
+int removeFullRows(FeatureBoard::Columns& columns, FeatureBoard::Rows& rows,
+                   std::uint32_t candidates)
+{
+    int lines = 0;
+    // from the top down, so that the rows still to check have not moved
+    while (candidates) {
+        int y = 31 - __builtin_clz(candidates);
+        candidates &= ~(1u << y);
+        if (rows[y] != fullRow) continue;
+        lines++;
+        std::copy(rows.begin() + y + 1, rows.end(), rows.begin() + y);
+        rows[HEIGHT - 1] = 0;
+        std::uint32_t below = (1u << y) - 1;
+        for (auto& column : columns)
+            column = (column & below) | (column >> 1 & ~below);
+    }
+    return lines;
+}
+
+}  // namespace
+
+// an empty board still has transitions, against the walls and the floor
+FeatureBoard::FeatureBoard() : features(measure(columns, rows)) {}
+
+void FeatureBoard::reset(const std::array<std::array<Square, HEIGHT>, WIDTH>& grid)
+{
+    columns = {};
+    rows = {};
+    for (int x = 0; x < WIDTH; x++) {
+        for (int y = 0; y < HEIGHT; y++) {
+            if (grid[x][y] == Empty) continue;
+            columns[x] |= 1u << y;
+            rows[y] |= 1u << x;
+        }
+    }
+    features = measure(columns, rows);
+}
+
+void FeatureBoard::add(const Squares& squares)
+{
+    features = place(squares, columns, rows, features);
+}
+
+int FeatureBoard::clearLines()
+{
+    int lines = removeFullRows(columns, rows, allRows);
+    if (lines) {
+        bool toppedOut = features.toppedOut;
+        features = measure(columns, rows);
+        features.toppedOut = toppedOut;
+    }
+    features.linesCleared = lines;
+    return lines;
+}
+
+const BoardFeatures& FeatureBoard::getFeatures() const { return features; }
+
+BoardFeatures FeatureBoard::after(const Squares& squares) const
+{
+    Columns c = columns;
+    Rows r = rows;
+    BoardFeatures f = place(squares, c, r, features);
+    int lines = removeFullRows(c, r, rowsOf(squares));
+    if (lines) {
+        bool toppedOut = f.toppedOut;
+        f = measure(c, r);
+        f.toppedOut = toppedOut;
+        f.linesCleared = lines;
+    }
+    return f;
+}
+
+const FeatureBoard::Columns& FeatureBoard::getColumns() const { return columns; }
+
+const FeatureBoard::Rows& FeatureBoard::getRows() const { return rows; }
@@ -0,0 +1,87 @@
+#ifndef FEATURES_H_
+#define FEATURES_H_
+
+#include "dimensions.hpp"
+#include "enums.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+// board features for evaluators, kept up to date as pieces are added
+//
+// the board is held twice as bitmasks, one per column (bit y is row y) and one per row (bit
+// x is column x), so every feature of a column or a row is a few bit operations. totals are
+// kept alongside, and adding a piece only takes out and puts back the terms of the at most
+// four columns and rows it touches, and of the columns either side for wells and bumpiness.
+// clearing lines moves every row, so it measures the board again, which is still only one
+// pass over the masks
+
+struct BoardFeatures
+{
+    // one above the highest full square of each column, 0 for an empty column
+    std::array<int, WIDTH> heights = {};
+    int maxHeight = 0;
+    int aggregateHeight = 0;
+
+    // empty squares with a full square somewhere above them in the same column
+    int holes = 0;
+
+    // changes between full and empty along each row, the walls count as full, so an empty
+    // row has 2
+    int rowTransitions = 0;
+
+    // changes between full and empty up each column, starting from the floor, which counts
+    // as full
+    int columnTransitions = 0;
+
+    // how far each column is below the lower of its neighbours, added up. walls are higher
+    // than any column
+    int wells = 0;
+
+    // height differences between neighbouring columns, added up
+    int bumpiness = 0;
+
+    // lines cleared by the placement these are the features after
+    int linesCleared = 0;
+
+    // part of the placement was above the board, which ends the game
+    bool toppedOut = false;
+};
+
+class FeatureBoard
+{
+public:
+    typedef std::array<std::uint32_t, WIDTH> Columns;
+    typedef std::array<std::uint32_t, HEIGHT> Rows;
+    typedef std::array<std::pair<int, int>, 4> Squares;
+
+    // an empty board
+    FeatureBoard();
+
+    // measure a whole grid
+    void reset(const std::array<std::array<Square, HEIGHT>, WIDTH>&);
+
+    // add the squares of a piece without clearing anything, squares above the board only
+    // set toppedOut
+    void add(const Squares&);
+
+    // take out the full rows, returning how many there were
+    int clearLines();
+
+    const BoardFeatures& getFeatures() const;
+
+    // the features once a piece with these squares is added and any full rows are cleared,
+    // leaving this board as it is
+    BoardFeatures after(const Squares&) const;
+
+    const Columns& getColumns() const;
+    const Rows& getRows() const;
+
+private:
+    Columns columns = {};
+    Rows rows = {};
+    BoardFeatures features;
+};
+
+#endif  // FEATURES_H_
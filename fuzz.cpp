@@ -0,0 +1,475 @@
+#include "batch.hpp"
+#include "features.hpp"
+#include "game.hpp"
+#include "perfect.hpp"
+#include "scheduler.hpp"
+#include "session.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// differential fuzzing of BatchEngine against Game, which is the reference model
+//
+// every lane of a BatchEngine and a Game with the same seed are fed the same random inputs,
+// and everything observable (board, score, last clear, active piece, hold, queue) is
+// compared after every step. the reference is also checked for properties that must hold
+// whatever the inputs: a piece never moves into the board and no full row survives a lock.
+// DelayLock games are also played by a Session, which only wakes up when gravity or the lock
+// delay has something to do, and must end up exactly where the Game ticked every tick does.
+// on the first divergence the inputs of that game are cut down to a short trace that still
+// diverges, printed so that it can be replayed with -t. before fuzzing, the perfect clear
+// solver has to find a clear it once ruled out
+//
+//   tetris-fuzz [-d] [-l level] [-k games] [-n steps] [-s seed] [-g gravity steps]
+//   tetris-fuzz [-d] [-l level] -s seed -t trace
+//
+// -d plays DelayLock games, with a tick in place of every gravity step. their start level is
+// -l, or worked out from the seed so that every gravity from the curve up to 20G gets played
+//
+// traces are one character per step: . none, < left, > right, x clockwise, z counter
+// clockwise, v softdrop, V harddrop, c hold, each optionally followed by g for gravity (or a
+// tick)
+
+namespace {
+
+const char* actionChars = ".<>xzvVc";
+
+LockMode lockMode = StepLock;
+
+// 0 to pick a level from the seed
+int fixedLevel = 0;
+
+int startLevel(unsigned int seed)
+{
+    if (fixedLevel > 0) return fixedLevel;
+    return lockMode == DelayLock ? 1 + seed % 20 : 1;
+}
+
+Game* newGame(unsigned int seed)
+{
+    Game* game = new Game(seed, lockMode, startLevel(seed));
+    game->getPlayfield().trackFeatures(true);
+    return game;
+}
+
+// nullptr for StepLock games, which sessions do not play
+Session* newSession(Scheduler& scheduler, unsigned int seed)
+{
+    if (lockMode != DelayLock) return nullptr;
+    return new Session(scheduler, seed, startLevel(seed));
+}
+
+// gravity for StepLock games, a tick for DelayLock games
+void step(Game& game)
+{
+    if (lockMode == DelayLock)
+        game.tick();
+    else
+        game.gravity();
+}
+
+void step(BatchEngine& batch)
+{
+    if (lockMode == DelayLock)
+        batch.tick();
+    else
+        batch.gravity();
+}
+
+struct Step
+{
+    Action action;
+    bool gravity;
+};
+
+// splitmix64, so that neighbouring games get unrelated input streams
+std::uint64_t mix(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// random inputs with a different mix of actions for each game, some play mostly sideways,
+// some rotate against the floor, so that between them every rule gets exercised
+class InputStream
+{
+public:
+    InputStream(std::uint64_t seed) : engine(mix(seed))
+    {
+        std::vector<int> weights(8);
+        for (auto& w : weights)
+            w = std::uniform_int_distribution<int>(0, 8)(engine);
+        weights[ActionHarddrop] /= 4;
+        weights[ActionHold] /= 2;
+        weights[ActionLeft] += 1;
+        actions = std::discrete_distribution<int>(weights.begin(), weights.end());
+    }
+
+    Action next() { return Action(actions(engine)); }
+
+private:
+    std::mt19937_64 engine;
+    std::discrete_distribution<int> actions;
+};
+
+// name of the first thing that differs between the reference and a lane, nullptr if they
+// agree
+const char* compare(Game& game, BatchEngine& batch, int lane)
+{
+    if (game.isGameOver() != batch.isGameOver(lane)) return "game over";
+    if (game.getScore() != batch.getScore(lane)) return "score";
+    ClearResult a = game.getPlayfield().getLastClear(), b = batch.getLastClear(lane);
+    if (a.lines != b.lines || a.spin != b.spin || a.perfectClear != b.perfectClear
+        || a.backToBack != b.backToBack || a.garbage != b.garbage)
+        return "last clear";
+    if (game.getPlayfield().getLevel() != batch.getLevel(lane)) return "level";
+    if (game.getPieceCount() != batch.getPieceCount(lane)) return "piece count";
+
+    auto grid = game.getPlayfield().getGrid();
+    auto rows = batch.getRows(lane);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            if ((grid[x][y] != Empty) != bool(rows[y] >> x & 1)) return "board";
+        }
+    }
+    // a finished game keeps whatever piece it died with, which nothing can see any more
+    if (game.isGameOver()) return nullptr;
+
+    Tetromino& active = game.getActivePiece();
+    if (active.getPiece() != batch.getPiece(lane)) return "active piece";
+    if (active.getRotation() != batch.getRotation(lane)) return "rotation";
+    if (active.getOrigin() != batch.getOrigin(lane)) return "position";
+    if (game.canHold() != batch.canHold(lane)) return "can hold";
+    Tetromino* carry = game.getCarryPiece();
+    if ((carry ? int(carry->getPiece()) : -1) != batch.getHold(lane)) return "hold";
+    auto upcoming = batch.getUpcoming(lane);
+    int i = 0;
+    for (auto& p : game.getUpcoming()) {
+        if (p->getPiece() != upcoming[i++]) return "queue";
+    }
+    return nullptr;
+}
+
+bool sameFeatures(const BoardFeatures& a, const BoardFeatures& b)
+{
+    return a.heights == b.heights && a.maxHeight == b.maxHeight
+           && a.aggregateHeight == b.aggregateHeight && a.holes == b.holes
+           && a.rowTransitions == b.rowTransitions && a.columnTransitions == b.columnTransitions
+           && a.wells == b.wells && a.bumpiness == b.bumpiness
+           && a.linesCleared == b.linesCleared && a.toppedOut == b.toppedOut;
+}
+
+// name of the first thing that differs between the reference and the game of a session,
+// nullptr if they agree
+const char* compare(Game& game, Session& session)
+{
+    Game& other = session.getGame();
+    if (game.isGameOver() != other.isGameOver()) return "session game over";
+    if (game.getScore() != other.getScore()) return "session score";
+    if (game.getPieceCount() != other.getPieceCount()) return "session piece count";
+    if (game.getPlayfield().getGrid() != other.getPlayfield().getGrid()) return "session board";
+    if (game.isGameOver()) return nullptr;
+    Tetromino& a = game.getActivePiece();
+    Tetromino& b = other.getActivePiece();
+    if (a.getTrueLocation() != b.getTrueLocation()) return "session active piece";
+    if (a.getLockTicks() != session.getLockTicks() || a.getLockResets() != b.getLockResets())
+        return "session lock delay";
+    if (game.canHold() != other.canHold()) return "session can hold";
+    return nullptr;
+}
+
+// properties of the reference itself, nullptr if they hold
+const char* checkProperties(Game& game)
+{
+    if (game.isGameOver()) return nullptr;
+    Playfield& playfield = game.getPlayfield();
+    Tetromino& active = game.getActivePiece();
+    // there is no block out rule, a piece may spawn on top of the stack, but every move
+    // checks the squares it moves into
+    bool spawned = active.getTrueLocation() == active.getDefaultLocation();
+    for (auto coord : active.getTrueLocation()) {
+        if (coord.first < 0 || coord.first >= WIDTH || coord.second < 0)
+            return "active piece out of bounds";
+        if (!spawned && coord.second < HEIGHT && playfield.squareFull(coord.first, coord.second))
+            return "active piece overlaps the board";
+    }
+    auto grid = playfield.getGrid();
+    for (int y = 0; y < HEIGHT; y++) {
+        int filled = 0;
+        for (int x = 0; x < WIDTH; x++)
+            filled += grid[x][y] != Empty;
+        if (filled == WIDTH) return "full row left on the board";
+    }
+
+    // tracked features against the board measured again, before and after placing the
+    // active piece where it is
+    FeatureBoard measured;
+    measured.reset(grid);
+    BoardFeatures tracked = playfield.getFeatures();
+    // what the last lock cleared, which a board measured from scratch can not know
+    tracked.linesCleared = 0;
+    if (!sameFeatures(tracked, measured.getFeatures())) return "board features";
+    auto squares = active.getTrueLocation();
+    for (auto coord : squares) {
+        if (coord.second < HEIGHT) grid[coord.first][coord.second] = active.getColour();
+    }
+    measured.reset(grid);
+    measured.clearLines();
+    BoardFeatures expected = measured.getFeatures();
+    for (auto coord : squares)
+        expected.toppedOut = expected.toppedOut || coord.second >= HEIGHT;
+    if (!sameFeatures(playfield.featuresAfter(squares), expected)) return "features after";
+    return nullptr;
+}
+
+struct Divergence
+{
+    int step = -1;
+    const char* what = nullptr;
+};
+
+// play a trace on a fresh Game, a one lane BatchEngine and a Session if there is one,
+// stopping at the first step after which they differ
+Divergence replay(unsigned int seed, const std::vector<Step>& trace)
+{
+    std::unique_ptr<Game> reference(newGame(seed));
+    Game& game = *reference;
+    BatchEngine batch(std::vector<unsigned int>{seed}, lockMode, startLevel(seed));
+    Scheduler scheduler;
+    std::unique_ptr<Session> session(newSession(scheduler, seed));
+    Divergence d;
+    for (std::size_t s = 0; s < trace.size(); s++) {
+        if (!game.isGameOver()) game.apply(trace[s].action);
+        batch.apply(&trace[s].action);
+        if (session) session->apply(trace[s].action);
+        if (trace[s].gravity) {
+            if (!game.isGameOver()) step(game);
+            step(batch);
+            scheduler.advance();
+        }
+        d.what = compare(game, batch, 0);
+        if (!d.what && session) d.what = compare(game, *session);
+        if (!d.what) d.what = checkProperties(game);
+        if (d.what) {
+            d.step = s;
+            return d;
+        }
+    }
+    return d;
+}
+
+// drop ever smaller runs of steps for as long as what is left still diverges
+std::vector<Step> minimise(unsigned int seed, std::vector<Step> trace)
+{
+    Divergence d = replay(seed, trace);
+    trace.resize(d.step + 1);
+    for (std::size_t chunk = trace.size() / 2; chunk > 0; chunk /= 2) {
+        for (std::size_t i = 0; i < trace.size();) {
+            std::vector<Step> shorter(trace.begin(), trace.begin() + i);
+            shorter.insert(
+              shorter.end(), trace.begin() + std::min(i + chunk, trace.size()), trace.end());
+            Divergence e = replay(seed, shorter);
+            if (e.what) {
+                shorter.resize(e.step + 1);
+                trace = shorter;
+            } else {
+                i += chunk;
+            }
+        }
+    }
+    return trace;
+}
+
+std::string format(const std::vector<Step>& trace)
+{
+    std::string out;
+    for (auto step : trace) {
+        out += actionChars[step.action];
+        if (step.gravity) out += 'g';
+    }
+    return out;
+}
+
+bool parse(const std::string& text, std::vector<Step>& trace)
+{
+    for (char c : text) {
+        if (c == 'g' && !trace.empty()) {
+            trace.back().gravity = true;
+            continue;
+        }
+        auto found = std::string(actionChars).find(c);
+        if (found == std::string::npos) return false;
+        trace.push_back({Action(found), false});
+    }
+    return true;
+}
+
+}  // namespace
+
+// whether the perfect clear solver finds a clear that needs rows to clear out of order, which
+// changes the colours of a checkerboard under the rows left
+bool solvesKnownClear()
+{
+    const char* rows[] = {".####..##.", "#########.", ".#........"};
+    std::array<std::array<Square, HEIGHT>, WIDTH> grid = {};
+    for (int y = 0; y < 3; y++) {
+        for (int x = 0; x < WIDTH; x++)
+            grid[x][y] = rows[y][x] == '#' ? Red : Empty;
+    }
+    FeatureBoard board;
+    board.reset(grid);
+    PerfectClearOptions options;
+    options.guaranteed = false;
+    options.threads = 1;
+    options.budget = 10000;
+    options.tableSize = std::size_t(1) << 16;
+    PerfectClearSolver solver(options);
+    PerfectClear found = solver.solve(board, Z, {I, J, I, L, I, S, L, S, S}, std::nullopt, true,
+                                      {});
+    return found.found && found.complete;
+}
+
+int main(int argc, char* argv[])
+{
+    int games = 1024;
+    int steps = 2000;
+    unsigned int seed = 1;
+    int gravitySteps = 3;
+    std::string traceText;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "dl:k:n:s:g:t:")) != -1) {
+        switch (opt) {
+        case 'd': lockMode = DelayLock; break;
+        case 'l': fixedLevel = std::atoi(optarg); break;
+        case 'k': games = std::atoi(optarg); break;
+        case 'n': steps = std::atoi(optarg); break;
+        case 's': seed = std::strtoul(optarg, nullptr, 10); break;
+        case 'g': gravitySteps = std::atoi(optarg); break;
+        case 't': traceText = optarg; break;
+        default:
+            std::cerr << "usage: " << argv[0]
+                      << " [-d] [-l level] [-k games] [-n steps] [-s seed] [-g gravity steps]"
+                      << " [-t trace]"
+                      << std::endl;
+            return -1;
+        }
+    }
+    if (games <= 0 || steps <= 0 || gravitySteps <= 0) return -1;
+
+    if (!traceText.empty()) {
+        std::vector<Step> trace;
+        if (!parse(traceText, trace)) {
+            std::cerr << "bad trace " << traceText << std::endl;
+            return -1;
+        }
+        Divergence d = replay(seed, trace);
+        if (!d.what) {
+            std::cout << "no divergence in " << trace.size() << " steps" << std::endl;
+            return 0;
+        }
+        std::cout << d.what << " differs after step " << d.step << std::endl;
+        return 1;
+    }
+
+    if (!solvesKnownClear()) {
+        std::cout << "the perfect clear solver misses a clear it has to find" << std::endl;
+        return 1;
+    }
+
+    // lane i plays seeds seed + i, seed + i + games, ... restarting when its game ends
+    std::vector<unsigned int> seeds(games);
+    std::vector<std::unique_ptr<Game>> reference;
+    std::vector<InputStream> inputs;
+    std::vector<std::vector<Step>> traces(games);
+    // one scheduler for every session, as a server would have
+    Scheduler scheduler;
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (int i = 0; i < games; i++) {
+        seeds[i] = seed + i;
+        reference.emplace_back(newGame(seeds[i]));
+        inputs.emplace_back(seeds[i]);
+        sessions.emplace_back(newSession(scheduler, seeds[i]));
+    }
+    BatchEngine batch(seeds, lockMode);
+    for (int i = 0; i < games; i++)
+        batch.restart(i, seeds[i], startLevel(seeds[i]));
+
+    std::vector<Action> actions(games);
+    std::chrono::duration<double> gameTime(0), batchTime(0);
+    std::uint64_t played = 0, finished = 0;
+    for (int s = 0; s < steps; s++) {
+        bool gravity = s % gravitySteps == gravitySteps - 1;
+        for (int i = 0; i < games; i++) {
+            actions[i] = inputs[i].next();
+            traces[i].push_back({actions[i], gravity});
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < games; i++) {
+            Game& game = *reference[i];
+            game.apply(actions[i]);
+            if (gravity && !game.isGameOver()) step(game);
+        }
+        auto middle = std::chrono::steady_clock::now();
+        batch.apply(actions.data());
+        if (gravity) step(batch);
+        auto end = std::chrono::steady_clock::now();
+        gameTime += middle - start;
+        batchTime += end - middle;
+        played += games;
+        if (lockMode == DelayLock) {
+            for (int i = 0; i < games; i++)
+                sessions[i]->apply(actions[i]);
+            if (gravity) scheduler.advance();
+        }
+
+        for (int i = 0; i < games; i++) {
+            const char* what = compare(*reference[i], batch, i);
+            if (!what && sessions[i]) what = compare(*reference[i], *sessions[i]);
+            if (!what) what = checkProperties(*reference[i]);
+            if (what) {
+                std::cout << "seed " << seeds[i] << ": " << what << " differs after "
+                          << traces[i].size() << " steps, minimising" << std::endl;
+                if (!replay(seeds[i], traces[i]).what) {
+                    std::cout << "seed " << seeds[i] << ": does not diverge when replayed alone"
+                              << std::endl;
+                    return 1;
+                }
+                auto trace = minimise(seeds[i], traces[i]);
+                std::cout << "seed " << seeds[i] << ": " << replay(seeds[i], trace).what
+                          << " differs after " << trace.size() << " steps" << std::endl;
+                std::cout << "  " << argv[0] << (lockMode == DelayLock ? " -d" : "") << " -l "
+                          << startLevel(seeds[i]) << " -s " << seeds[i] << " -t "
+                          << format(trace) << std::endl;
+                return 1;
+            }
+            if (reference[i]->isGameOver()) {
+                finished++;
+                seeds[i] += games;
+                reference[i].reset(newGame(seeds[i]));
+                sessions[i].reset(newSession(scheduler, seeds[i]));
+                inputs[i] = InputStream(seeds[i]);
+                traces[i].clear();
+                batch.restart(i, seeds[i], startLevel(seeds[i]));
+            }
+        }
+    }
+
+    std::cout << played << " steps in " << games << " lanes, " << finished
+              << " games finished, no divergence" << std::endl;
+    std::cout << "Game        " << played / gameTime.count() / 1e6 << "M steps/s" << std::endl;
+    std::cout << "BatchEngine " << played / batchTime.count() / 1e6 << "M steps/s ("
+              << gameTime.count() / batchTime.count() << "x)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include "game.hpp"
+
+#include "timing.hpp"
+
+#include <random>
+#include <utility>
+
+Game::Game() : Game(std::random_device()()) {}
+
+Game::Game(unsigned int seed, LockMode mode, int startLevel)
+  : playfield(startLevel), generator(seed), lockMode(mode)
+{
+    for (int i = 0; i < previewSize; i++)
+        upcoming.push_back(makePiece(generator.getNextPiece()));
+    nextPiece();
+}
+
+// moves made by gravity are not recorded, they would outnumber everything else
+void Game::gravity()
+{
+    if (lockMode == DelayLock) {
+        activePiece->fall(1);
+        return;
+    }
+    activePiece->moveDownOrAdd();
+    handleLock();
+}
+
+void Game::tick()
+{
+    if (lockMode != DelayLock) return;
+    if (activePiece->tick(gravityAt(playfield.getLevel()))) lock();
+}
+
+void Game::lock()
+{
+    activePiece->lock();
+    handleLock();
+}
+
+void Game::moveHorizontal(int dir)
+{
+    if (activePiece->moveHorizontal(dir)) emit(MoveEvent);
+}
+
+void Game::rotate(Rotation r)
+{
+    activePiece->rotate(r);
+    emit(RotateEvent, activePiece->getLastKick());
+}
+
+void Game::softdrop()
+{
+    if (lockMode == DelayLock) {
+        if (activePiece->fall(1)) emit(MoveEvent);
+        return;
+    }
+    auto before = activePiece->getOrigin();
+    activePiece->moveDownOrAdd();
+    if (activePiece->getOrigin() != before) emit(MoveEvent);
+    handleLock();
+}
+
+void Game::harddrop()
+{
+    if (lockMode == DelayLock) {
+        activePiece->fall(activePiece->dropDistance());
+        activePiece->lock();
+    } else {
+        // the piece is set once it lands, so one more step adds it to the playfield
+        activePiece->harddrop();
+        activePiece->moveDownOrAdd();
+    }
+    handleLock();
+}
+
+void Game::hold()
+{
+    if (!swappable) return;
+    if (carryPiece) {
+        std::swap(activePiece, carryPiece);
+        activePiece->resetPosition();
+    } else {
+        carryPiece = std::move(activePiece);
+        nextPiece();
+    }
+    carryPiece->resetPosition();
+    swappable = false;
+    emit(HoldEvent);
+}
+
+void Game::apply(Action a)
+{
+    switch (a) {
+    case ActionLeft: moveHorizontal(-1); break;
+    case ActionRight: moveHorizontal(1); break;
+    case ActionClockwise: rotate(Clockwise); break;
+    case ActionCounterClockwise: rotate(CounterClockwise); break;
+    case ActionSoftdrop: softdrop(); break;
+    case ActionHarddrop: harddrop(); break;
+    case ActionHold: hold(); break;
+    default: break;
+    }
+}
+
+bool Game::canHold() { return swappable; }
+
+bool Game::isGameOver() { return playfield.isGameOver(); }
+
+unsigned int Game::getScore() { return score; }
+
+std::uint32_t Game::getPieceCount() { return pieceCount; }
+
+Playfield& Game::getPlayfield() { return playfield; }
+
+Tetromino& Game::getActivePiece() { return *activePiece; }
+
+Tetromino* Game::getCarryPiece() { return carryPiece.get(); }
+
+const std::list<std::unique_ptr<Tetromino>>& Game::getUpcoming() { return upcoming; }
+
+std::vector<Piece> Game::getBagLeft() { return generator.getBagLeft(); }
+
+void Game::setEventWriter(EventLog::Writer* writer, std::uint64_t id)
+{
+    events = writer;
+    gameId = id;
+    // the active piece spawned before anything was listening
+    emit(SpawnEvent);
+}
+
+std::array<std::array<Square, HEIGHT>, WIDTH> Game::getGridWithActive()
+{
+    auto grid = playfield.getGrid();
+    // active piece is not in the grid by default
+    for (auto coord : activePiece->getTrueLocation()) {
+        if (coord.first >= 0 && coord.first < WIDTH && coord.second >= 0 && coord.second < HEIGHT)
+            grid.at(coord.first).at(coord.second) = activePiece->getColour();
+    }
+    return grid;
+}
+
+void Game::handleLock()
+{
+    if (!activePiece->isAdded()) return;
+    emit(LockEvent);
+    if (playfield.isGameOver()) {
+        emit(GameOverEvent);
+        return;
+    }
+    score += playfield.handleFullLines(activeSpin());
+    ClearResult clear = playfield.getLastClear();
+    if (clear.lines > 0 || clear.spin != NoSpin) emit(ClearEvent, 0, clear);
+    nextPiece();
+    swappable = true;
+}
+
+void Game::nextPiece()
+{
+    activePiece = std::move(upcoming.front());
+    upcoming.pop_front();
+    upcoming.push_back(makePiece(generator.getNextPiece()));
+    pieceCount++;
+    emit(SpawnEvent);
+}
+
+Spin Game::activeSpin()
+{
+    int kick = activePiece->getLastMoveKick();
+    if (activePiece->getPiece() != T || kick < 0) return NoSpin;
+    // the corners around the centre of the T, which is its origin
+    auto centre = activePiece->getOrigin();
+    int x = centre.first, y = centre.second;
+    int corners = playfield.squareFull(x - 1, y + 1) * TopLeft
+                  | playfield.squareFull(x + 1, y + 1) * TopRight
+                  | playfield.squareFull(x + 1, y - 1) * BottomRight
+                  | playfield.squareFull(x - 1, y - 1) * BottomLeft;
+    return spinFromCorners(activePiece->getRotation(), corners, kick);
+}
+
+void Game::emit(EventType type, int kick, const ClearResult& clear)
+{
+    if (!events) return;
+    auto origin = activePiece->getOrigin();
+    GameEvent e = {};
+    e.game = gameId;
+    e.sequence = eventCount++;
+    e.pieceCount = pieceCount;
+    e.type = type;
+    e.piece = activePiece->getPiece();
+    e.x = origin.first;
+    e.y = origin.second;
+    e.rotation = activePiece->getRotation();
+    e.kick = kick;
+    e.lines = clear.lines;
+    e.combo = clear.combo;
+    e.scoreDelta = clear.points;
+    e.spin = clear.spin;
+    e.flags = clear.perfectClear * PerfectClearFlag | clear.backToBack * BackToBackFlag;
+    e.garbage = clear.garbage;
+    e.level = clear.level;
+    events->append(e);
+}
+
+std::unique_ptr<Tetromino> Game::makePiece(Piece p)
+{
+    switch (p) {
+    case I: return std::make_unique<Tetromino>(IPiece(&playfield));
+    case J: return std::make_unique<Tetromino>(JPiece(&playfield));
+    case L: return std::make_unique<Tetromino>(LPiece(&playfield));
+    case O: return std::make_unique<Tetromino>(OPiece(&playfield));
+    case S: return std::make_unique<Tetromino>(SPiece(&playfield));
+    case T: return std::make_unique<Tetromino>(TPiece(&playfield));
+    case Z: return std::make_unique<Tetromino>(ZPiece(&playfield));
+    }
+    return nullptr;
+}
@@ -0,0 +1,121 @@
+#ifndef GAME_H_
+#define GAME_H_
+
+#include "dimensions.hpp"
+#include "enums.hpp"
+#include "eventlog.hpp"
+#include "generator.hpp"
+#include "playfield.hpp"
+#include "scoring.hpp"
+#include "tetrominos.hpp"
+
+#include <array>
+#include <list>
+#include <memory>
+#include <vector>
+
+// a single game of tetris: the playfield, the active piece, the preview queue and the hold
+// slot. frontends (opengl, terminal) own a Game and decide when to call into it, the game
+// itself has no notion of wall-clock time
+
+class Game
+{
+public:
+    Game();
+
+    // pieces come from a generator with the given seed, so the game can be replayed
+    Game(unsigned int seed, LockMode = StepLock, int startLevel = 1);
+
+    // pieces hold a pointer to the playfield, so a game can not be copied or moved
+    Game(const Game&) = delete;
+    Game& operator=(const Game&) = delete;
+
+    // move the active piece down by one, locking it and spawning the next piece if it was
+    // already resting on something. in a DelayLock game the same as a softdrop
+    void gravity();
+
+    // one tick of a DelayLock game: gravity for the current level and the lock delay, locking
+    // and spawning the next piece if it runs out. does nothing in a StepLock game
+    void tick();
+
+    // lock the active piece where it is and spawn the next, for DelayLock games that keep
+    // their own time instead of calling tick (see Session)
+    void lock();
+
+    // player actions on the active piece
+    void moveHorizontal(int);
+    void rotate(Rotation);
+    void softdrop();
+    void harddrop();
+
+    // swap the active piece with the held piece, at most once per piece
+    void hold();
+
+    // any of the above
+    void apply(Action);
+    bool canHold();
+
+    bool isGameOver();
+    unsigned int getScore();
+
+    // number of pieces spawned so far, including the active piece
+    std::uint32_t getPieceCount();
+
+    Playfield& getPlayfield();
+    Tetromino& getActivePiece();
+
+    // nullptr if nothing has been held yet
+    Tetromino* getCarryPiece();
+
+    const std::list<std::unique_ptr<Tetromino>>& getUpcoming();
+
+    // the pieces the generator still has to hand out from its current bag, which come right
+    // after the queue, sorted. after them come whole bags
+    std::vector<Piece> getBagLeft();
+
+    // the grid with the active piece drawn in
+    std::array<std::array<Square, HEIGHT>, WIDTH> getGridWithActive();
+
+    // record everything that happens from now on, until called again with nullptr, starting
+    // with a spawn of the current active piece. the writer must belong to the thread that
+    // drives this game
+    void setEventWriter(EventLog::Writer*, std::uint64_t gameId);
+
+    // number of pieces shown in the preview queue
+    static constexpr int previewSize = 4;
+
+private:
+    Playfield playfield;
+    RandomGenerator generator;
+    LockMode lockMode;
+
+    std::unique_ptr<Tetromino> activePiece;
+    std::unique_ptr<Tetromino> carryPiece;
+    std::list<std::unique_ptr<Tetromino>> upcoming;
+
+    // cleared when a piece is held, set again when the next piece spawns
+    bool swappable = true;
+
+    unsigned int score = 0;
+
+    EventLog::Writer* events = nullptr;
+    std::uint64_t gameId = 0;
+    std::uint32_t eventCount = 0;
+    std::uint32_t pieceCount = 0;
+
+    // append an event about the active piece, if events are being recorded
+    void emit(EventType, int kick = 0, const ClearResult& = ClearResult());
+
+    // if the active piece has been added to the playfield, clear lines and spawn the next one
+    void handleLock();
+
+    // whether the active piece, just added to the playfield, made a T-spin
+    Spin activeSpin();
+
+    // take the front of the queue as the active piece and refill the queue
+    void nextPiece();
+
+    std::unique_ptr<Tetromino> makePiece(Piece);
+};
+
+#endif  // GAME_H_
@@ -1,10 +1,10 @@
 #include "generator.hpp"
 
-RandomGenerator::RandomGenerator()
+RandomGenerator::RandomGenerator() : RandomGenerator(std::random_device()()) {}
+
+RandomGenerator::RandomGenerator(unsigned int seed) : engine(seed)
 {
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(pieces.begin(), pieces.end(), g);
+    std::shuffle(pieces.begin(), pieces.end(), engine);
     lastBag = pieces;
     currentBag = pieces;
 }
@@ -23,8 +23,13 @@ Piece RandomGenerator::getNextPiece()
 
 void RandomGenerator::generateNextBag()
 {
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(pieces.begin(), pieces.end(), g);
+    std::shuffle(pieces.begin(), pieces.end(), engine);
     currentBag = pieces;
 }
+
+std::vector<Piece> RandomGenerator::getBagLeft()
+{
+    std::vector<Piece> left(currentBag.begin() + index, currentBag.end());
+    std::sort(left.begin(), left.end());
+    return left;
+}
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <array>
 #include <random>
+#include <vector>
 
 // the tetris piece generator has to follow a specific set of rules, so we define the
 // generator functions here in a class
@@ -17,11 +18,21 @@ private:
     std::array<Piece, 7> lastBag;
     std::array<Piece, 7> currentBag;
     short index = 0;
+    std::mt19937 engine;
 
 public:
+    // seeded from std::random_device
     RandomGenerator();
+
+    // the same seed always gives the same sequence of pieces, for replays and headless games
+    RandomGenerator(unsigned int seed);
+
     Piece getNextPiece();
     void generateNextBag();
+
+    // the pieces still to come from the current bag, sorted, so they say which pieces are
+    // left but nothing about the order they come in
+    std::vector<Piece> getBagLeft();
 };
 
 #endif  // GENERATOR_H_
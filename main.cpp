@@ -1,23 +1,36 @@
-#include "generator.hpp"
-#include "playfield.hpp"
-#include "tetrominos.hpp"
+#include "game.hpp"
+#include "scheduler.hpp"
+#include "session.hpp"
+#include "shader.hpp"
+#include "snapshot.hpp"
+#include "timing.hpp"
+#include "triplebuffer.hpp"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
-#include <list>
-#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
 
-Tetromino makePiece(Piece, Playfield*);
+// three threads: the main thread handles window events, which glfw requires, the simulation
+// thread runs the game at a fixed tick rate and the render thread owns the opengl context.
+// the game reaches the renderer only through snapshots in a triple buffer, so a slow buffer
+// swap never delays gravity or input, and a busy simulation never delays a frame
 
 void framebuffer_size_callback(GLFWwindow*, int, int);
 
-void processInput(GLFWwindow*);
+void key_callback(GLFWwindow*, int, int, int, int);
+
+void simulate();
+
+void processInput(Session&);
 
 GLsizei windowWidth = 800;
 GLsizei windowHeight = 1000;
-std::size_t infoLogSize = 1024;
 
 const char* vShaderSource = "#version 330 core\n"
                             "layout (location = 0) in vec2 aPos;\n"
@@ -34,17 +47,63 @@ const char* fShaderSource = "#version 330 core\n"
                             "FragColor = vec4(colour, 1.0f);\n"
                             "}";
 
-std::unique_ptr<Tetromino> activePiece;
-std::unique_ptr<Tetromino> carryPiece;
-std::list<std::unique_ptr<Tetromino>> upcoming;
-bool swappable = true;
-Playfield playfield;
-RandomGenerator generator = RandomGenerator();
+// simulation ticks per second, every game timing below is a number of ticks
+constexpr int tickRate = ticksPerSecond;
+constexpr std::chrono::nanoseconds tickPeriod(1000000000 / tickRate);
+
+// how far the simulation may fall behind (the process was stopped, say) before it gives up
+// on catching up and carries on from now
+constexpr std::chrono::milliseconds maxLag(250);
+
+// latest state of the game, from the simulation thread to the render thread
+TripleBuffer<Snapshot> snapshots;
+
+// cleared when the game ends or the window closes, every thread then finishes
+std::atomic<bool> running{true};
+
+// set by the framebuffer callback on the main thread, applied by the render thread
+std::atomic<int> framebufferWidth{windowWidth};
+std::atomic<int> framebufferHeight{windowHeight};
+std::atomic<bool> resized{false};
+
+// keys the game uses, one bit each in heldKeys and pressedKeys
+enum Key {
+    KeyLeft = 1 << 0,
+    KeyH = 1 << 1,
+    KeyRight = 1 << 2,
+    KeyL = 1 << 3,
+    KeyZ = 1 << 4,
+    KeyUp = 1 << 5,
+    KeyK = 1 << 6,
+    KeyX = 1 << 7,
+    KeyDown = 1 << 8,
+    KeyJ = 1 << 9,
+    KeySpace = 1 << 10,
+    KeyC = 1 << 11
+};
+
+// keys currently down, kept by the key callback
+std::atomic<unsigned int> heldKeys{0};
+
+// keys pressed since the simulation last looked, so that a tap shorter than a tick counts
+std::atomic<unsigned int> pressedKeys{0};
 
 int main(int argc, char* argv[])
 {
+    // time each phase of startup, reported once the first frame is on screen
+    auto startupBegin = std::chrono::steady_clock::now();
+    auto phaseBegin = startupBegin;
+    std::ostringstream startup;
+    auto phase = [&](const char* name) {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> took = now - phaseBegin;
+        startup << name << " " << took.count() << "ms, ";
+        phaseBegin = now;
+    };
+
     // GLFW initialization, configuration and window creation
     glfwInit();
+    phase("glfw");
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -56,53 +115,22 @@ int main(int argc, char* argv[])
         return -1;
     }
     glfwMakeContextCurrent(win);
+    phase("window");
     GLenum err = glewInit();
     if (err != GLEW_OK) {
         std::cerr << "glewInit failed" << std::endl;
         glfwTerminate();
         return -1;
     }
+    phase("glew");
     glViewport(0, 0, windowWidth, windowHeight);
     glfwSetFramebufferSizeCallback(win, framebuffer_size_callback);
 
-    // TODO shaders + textures
-    int success;
-    char infoLog[infoLogSize];
-    unsigned int vShader;
-    vShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vShader, 1, &vShaderSource, NULL);
-    glCompileShader(vShader);
-    glGetShaderiv(vShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vShader, infoLogSize, NULL, infoLog);
-        std::cerr << "VERTEX SHADER COMPILATION FAILED" << std::endl << infoLog << std::endl;
-        return -1;
-    }
-    unsigned int fShader;
-    fShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fShader, 1, &fShaderSource, NULL);
-    glCompileShader(fShader);
-    glGetShaderiv(fShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fShader, infoLogSize, NULL, infoLog);
-        std::cerr << "FRAGMENT SHADER COMPILATION FAILED" << std::endl << infoLog << std::endl;
-        return -1;
-    }
-    unsigned int shader;
-    shader = glCreateProgram();
-    glAttachShader(shader, vShader);
-    glAttachShader(shader, fShader);
-    glLinkProgram(shader);
-    glGetProgramiv(shader, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shader, infoLogSize, NULL, infoLog);
-        std::cerr << "SHADER LINKING FAILED" << std::endl << infoLog << std::endl;
-        return -1;
-    }
-
-    // shaders are linked, delete to free resources
-    glDeleteShader(vShader);
-    glDeleteShader(fShader);
+    // TODO textures
+    bool cached;
+    unsigned int shader = loadProgram(vShaderSource, fShaderSource, &cached);
+    if (!shader) return -1;
+    phase(cached ? "shaders (cached)" : "shaders (compiled)");
 
     // 4 corners of a square
     // NOTE these MUST be in the in the order, BL, TL, TR, BR
@@ -128,162 +156,193 @@ int main(int argc, char* argv[])
 
     int colourLocation = glGetUniformLocation(shader, "colour");
 
-    for (int i = 0; i < 4; i++)
-        upcoming.push_back(
-          std::make_unique<Tetromino>(makePiece(generator.getNextPiece(), &playfield)));
-
-    activePiece = std::move(upcoming.front());
-    upcoming.pop_front();
-    upcoming.push_back(
-      std::make_unique<Tetromino>(makePiece(generator.getNextPiece(), &playfield)));
-    std::chrono::system_clock::time_point lastTimestamp = std::chrono::system_clock::now();
-    std::chrono::system_clock::time_point currentTimestamp;
-    std::chrono::duration<float> Dt;
-    std::chrono::duration<float> levelTime = std::chrono::milliseconds(300);
-    unsigned int score = 0;
-    // within a second, this loop will repeat very many times, so don't worry too much
-    // about being capable of infinite rotations or piece movement
-    while (!playfield.isGameOver() && !glfwWindowShouldClose(win)) {
-        // process inputs
-        processInput(win);
-
-        // manage the game
-        currentTimestamp = std::chrono::system_clock::now();
-        Dt = currentTimestamp - lastTimestamp;
-
-        if (Dt >= levelTime) {
-            lastTimestamp = currentTimestamp;
-            activePiece->moveDownOrAdd();
-            if (activePiece->isAdded()) {
-                int inc = playfield.handleFullLines();
-                activePiece = std::move(upcoming.front());
-                upcoming.pop_front();
-                upcoming.push_back(
-                  std::make_unique<Tetromino>(makePiece(generator.getNextPiece(), &playfield)));
-                swappable = true;
-            }
-        }
+    glfwSetKeyCallback(win, key_callback);
 
-        // rendering
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);  // base background colour
-        glClear(GL_COLOR_BUFFER_BIT);
-        glUseProgram(shader);
+    // the context belongs to the render thread from now on
+    glfwMakeContextCurrent(NULL);
+    std::thread simulation(simulate);
+    std::thread renderer([&] {
+        glfwMakeContextCurrent(win);
+        glfwSwapInterval(1);
+        bool firstFrame = true;
+        while (running) {
+            if (resized.exchange(false))
+                glViewport(0, 0, framebufferWidth.load(), framebufferHeight.load());
 
-        auto grid = playfield.getGrid();
-        // active piece is not in the grid by default
-        for (auto coord : activePiece->getTrueLocation()) {
-            if (coord.first < WIDTH && coord.second < HEIGHT)
-                grid.at(coord.first).at(coord.second) = activePiece->getColour();
-        }
-        // colours for different squares
-        for (int x = 0; x < WIDTH; x++) {
-            for (int y = 0; y < HEIGHT; y++) {
-                switch (grid.at(x).at(y)) {
-                case Empty:  // different coloured columns
-                    if (x % 2 == 0)
-                        glUniform3f(colourLocation, 0.3f, 0.3f, 0.3f);
-                    else
-                        glUniform3f(colourLocation, 0.4f, 0.4f, 0.4f);
-                    break;
-                case Cyan: glUniform3f(colourLocation, 0.0f, 1.0f, 1.0f); break;
-                case Blue: glUniform3f(colourLocation, 0.0f, 0.0f, 1.0f); break;
-                case Orange: glUniform3f(colourLocation, 1.0f, 0.647f, 0.0f); break;
-                case Yellow: glUniform3f(colourLocation, 1.0f, 1.0f, 0.0f); break;
-                case Green: glUniform3f(colourLocation, 0.0f, 1.0f, 0.0f); break;
-                case Pink: glUniform3f(colourLocation, 1.0f, 0.412f, 0.705f); break;
-                case Red: glUniform3f(colourLocation, 1.0f, 0.0f, 0.0f); break;
+            // whatever the simulation published last, possibly the same as last frame
+            snapshots.update();
+            const Snapshot& snapshot = snapshots.front();
+
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);  // base background colour
+            glClear(GL_COLOR_BUFFER_BIT);
+            glUseProgram(shader);
+
+            auto& grid = snapshot.grid;
+            // colours for different squares
+            for (int x = 0; x < WIDTH; x++) {
+                for (int y = 0; y < HEIGHT; y++) {
+                    switch (grid.at(x).at(y)) {
+                    case Empty:  // different coloured columns
+                        if (x % 2 == 0)
+                            glUniform3f(colourLocation, 0.3f, 0.3f, 0.3f);
+                        else
+                            glUniform3f(colourLocation, 0.4f, 0.4f, 0.4f);
+                        break;
+                    case Cyan: glUniform3f(colourLocation, 0.0f, 1.0f, 1.0f); break;
+                    case Blue: glUniform3f(colourLocation, 0.0f, 0.0f, 1.0f); break;
+                    case Orange: glUniform3f(colourLocation, 1.0f, 0.647f, 0.0f); break;
+                    case Yellow: glUniform3f(colourLocation, 1.0f, 1.0f, 0.0f); break;
+                    case Green: glUniform3f(colourLocation, 0.0f, 1.0f, 0.0f); break;
+                    case Pink: glUniform3f(colourLocation, 1.0f, 0.412f, 0.705f); break;
+                    case Red: glUniform3f(colourLocation, 1.0f, 0.0f, 0.0f); break;
+                    }
+                    // calculations to get corners in normalised coordinate system
+                    // Bottom Left
+                    vertices[0] = -1 + (double)(2 * x) / WIDTH;
+                    vertices[1] = -1 + (double)(2 * y) / HEIGHT;
+                    // Top Left
+                    vertices[2] = -1 + (double)(2 * x) / WIDTH;
+                    vertices[3] = -1 + (double)(2 * y + 2) / HEIGHT;
+                    // Top Right
+                    vertices[4] = -1 + (double)(2 * x + 2) / WIDTH;
+                    vertices[5] = -1 + (double)(2 * y + 2) / HEIGHT;
+                    // Bottom Right
+                    vertices[6] = -1 + (double)(2 * x + 2) / WIDTH;
+                    vertices[7] = -1 + (double)(2 * y) / HEIGHT;
+
+                    // draw in the current square
+                    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+                    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
+                    glVertexAttribPointer(0, 2, GL_DOUBLE, GL_FALSE, 2 * sizeof(double), (void*)0);
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+                    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
                 }
-                // calculations to get corners in normalised coordinate system
-                // Bottom Left
-                vertices[0] = -1 + (double)(2 * x) / WIDTH;
-                vertices[1] = -1 + (double)(2 * y) / HEIGHT;
-                // Top Left
-                vertices[2] = -1 + (double)(2 * x) / WIDTH;
-                vertices[3] = -1 + (double)(2 * y + 2) / HEIGHT;
-                // Top Right
-                vertices[4] = -1 + (double)(2 * x + 2) / WIDTH;
-                vertices[5] = -1 + (double)(2 * y + 2) / HEIGHT;
-                // Bottom Right
-                vertices[6] = -1 + (double)(2 * x + 2) / WIDTH;
-                vertices[7] = -1 + (double)(2 * y) / HEIGHT;
-
-                // draw in the current square
-                glBindBuffer(GL_ARRAY_BUFFER, VBO);
-                glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-                glVertexAttribPointer(0, 2, GL_DOUBLE, GL_FALSE, 2 * sizeof(double), (void*)0);
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
+            }
+
+            glfwSwapBuffers(win);
+            if (firstFrame) {
+                firstFrame = false;
+                phase("first frame");
+                std::chrono::duration<double, std::milli> total = phaseBegin - startupBegin;
+                std::cerr << "startup: " << startup.str() << "total " << total.count() << "ms"
+                          << std::endl;
             }
         }
+        glfwMakeContextCurrent(NULL);
+    });
 
-        glfwSwapBuffers(win);
-        glfwPollEvents();
-    }
+    // the main thread only waits for window events, the simulation wakes it when the game
+    // is over
+    while (running && !glfwWindowShouldClose(win))
+        glfwWaitEvents();
+    running = false;
+    simulation.join();
+    renderer.join();
+    glfwTerminate();
 
     return 0;
 }
 
-Tetromino makePiece(Piece p, Playfield* play)
+// change viewport on resize, the render thread owns the context so it does the change
+void framebuffer_size_callback(GLFWwindow* win, int width, int height)
+{
+    framebufferWidth = width;
+    framebufferHeight = height;
+    resized = true;
+}
+
+void key_callback(GLFWwindow* win, int key, int scancode, int action, int mods)
 {
-    switch (p) {
-    case I: return IPiece(play);
-    case J: return JPiece(play);
-    case L: return LPiece(play);
-    case O: return OPiece(play);
-    case S: return SPiece(play);
-    case T: return TPiece(play);
-    case Z: return ZPiece(play);
+    if ((key == GLFW_KEY_ESCAPE || key == GLFW_KEY_Q) && action == GLFW_PRESS) {
+        glfwSetWindowShouldClose(win, true);
+        return;
+    }
+    unsigned int bit;
+    switch (key) {
+    case GLFW_KEY_LEFT: bit = KeyLeft; break;
+    case GLFW_KEY_H: bit = KeyH; break;
+    case GLFW_KEY_RIGHT: bit = KeyRight; break;
+    case GLFW_KEY_L: bit = KeyL; break;
+    case GLFW_KEY_Z: bit = KeyZ; break;
+    case GLFW_KEY_UP: bit = KeyUp; break;
+    case GLFW_KEY_K: bit = KeyK; break;
+    case GLFW_KEY_X: bit = KeyX; break;
+    case GLFW_KEY_DOWN: bit = KeyDown; break;
+    case GLFW_KEY_J: bit = KeyJ; break;
+    case GLFW_KEY_SPACE: bit = KeySpace; break;
+    case GLFW_KEY_C: bit = KeyC; break;
+    default: return;
+    }
+    if (action == GLFW_PRESS) {
+        heldKeys |= bit;
+        pressedKeys |= bit;
+    } else if (action == GLFW_RELEASE) {
+        heldKeys &= ~bit;
     }
 }
 
-// change viewport on resize
-void framebuffer_size_callback(GLFWwindow* win, int width, int height)
+// run the game at tickRate until it is over or the window closes, publishing a snapshot
+// after every tick. ticks are scheduled from a fixed start, so late wakeups do not add up
+void simulate()
 {
-    glViewport(0, 0, width, height);
+    // held keys repeat every 6 ticks, a softdrop every 3 and a harddrop every 18
+    SessionTiming timing;
+    for (Action a : {ActionLeft, ActionRight, ActionClockwise, ActionCounterClockwise})
+        timing.repeat[a] = {6, 6};
+    timing.repeat[ActionSoftdrop] = {3, 3};
+    timing.repeat[ActionHarddrop] = {18, 18};
+
+    Scheduler scheduler;
+    std::random_device device;
+    Session session(scheduler, device(), 1, timing);
+    Game& game = session.getGame();
+    snapshots.back().capture(game, scheduler.now());
+    snapshots.publish();
+
+    auto next = std::chrono::steady_clock::now();
+    while (running && !game.isGameOver()) {
+        next += tickPeriod;
+        std::this_thread::sleep_until(next);
+        auto now = std::chrono::steady_clock::now();
+        if (now - next > maxLag) next = now;
+
+        processInput(session);
+        scheduler.advance();
+
+        snapshots.back().capture(game, scheduler.now());
+        snapshots.publish();
+    }
+    running = false;
+    glfwPostEmptyEvent();
 }
 
-std::chrono::system_clock::time_point lastHarddrop;
-std::chrono::system_clock::time_point lastSoftdrop;
-std::chrono::duration<float> harddropTimeout = std::chrono::milliseconds(300);
-std::chrono::duration<float> softdropTimeout = std::chrono::milliseconds(50);
+// keys of each action
+const unsigned int actionKeys[actionCount] = {
+  0, KeyLeft | KeyH, KeyRight | KeyL, KeyZ | KeyUp | KeyK, KeyX, KeyDown | KeyJ, KeySpace, KeyC};
+
+// actions whose keys were down when the simulation last looked, one bit each
+unsigned int heldActions = 0;
 
-void processInput(GLFWwindow* win)
+// turn the keys that went down and up since the last tick into presses and releases, the
+// session repeats held actions itself
+void processInput(Session& session)
 {
-    if (glfwGetKey(win, GLFW_KEY_ESCAPE) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_Q) == GLFW_PRESS)
-        glfwSetWindowShouldClose(win, true);
-    if (glfwGetKey(win, GLFW_KEY_LEFT) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_H) == GLFW_PRESS)
-        activePiece->moveHorizontal(-1);
-    if (glfwGetKey(win, GLFW_KEY_RIGHT) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_L) == GLFW_PRESS)
-        activePiece->moveHorizontal(1);
-    if (glfwGetKey(win, GLFW_KEY_Z) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_UP) == GLFW_PRESS
-        || glfwGetKey(win, GLFW_KEY_K))
-        activePiece->rotate(Clockwise);
-    if (glfwGetKey(win, GLFW_KEY_X) == GLFW_PRESS) activePiece->rotate(CounterClockwise);
-    if (glfwGetKey(win, GLFW_KEY_DOWN) == GLFW_PRESS || glfwGetKey(win, GLFW_KEY_J) == GLFW_PRESS) {
-        auto currentTime = std::chrono::system_clock::now();
-        if (currentTime - lastSoftdrop >= softdropTimeout) {
-            activePiece->moveDownOrAdd();
-            lastSoftdrop = currentTime;
-        }
-    }
-    if (glfwGetKey(win, GLFW_KEY_SPACE) == GLFW_PRESS) {
-        auto currentTime = std::chrono::system_clock::now();
-        if (currentTime - lastHarddrop >= harddropTimeout) {
-            activePiece->harddrop();
-            lastHarddrop = currentTime;
-        }
-    }
-    if (glfwGetKey(win, GLFW_KEY_C) == GLFW_PRESS) {
-        if (carryPiece && swappable) {
-            std::swap(activePiece, carryPiece);
-            activePiece->resetPosition();
-        } else if (swappable) {
-            carryPiece = std::move(activePiece);
-            activePiece =
-              std::make_unique<Tetromino>(makePiece(generator.getNextPiece(), &playfield));
-            activePiece->resetPosition();
+    unsigned int pressed = pressedKeys.exchange(0);
+    unsigned int held = heldKeys.load();
+    for (int a = ActionLeft; a < actionCount; a++) {
+        bool down = held & actionKeys[a];
+        bool wasDown = heldActions >> a & 1;
+        if (pressed & actionKeys[a]) {
+            // pressed again, or tapped between two ticks
+            if (wasDown) session.release(Action(a));
+            session.press(Action(a));
+            if (!down) session.release(Action(a));
+        } else if (down && !wasDown) {
+            session.press(Action(a));
+        } else if (!down && wasDown) {
+            session.release(Action(a));
         }
-        swappable = false;
+        heldActions = down ? heldActions | 1u << a : heldActions & ~(1u << a);
     }
 }
@@ -0,0 +1,281 @@
+#include "mcts.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+
+constexpr std::uint8_t wholeBag = 0x7f;
+
+float meanOf(std::uint32_t visits, float total, float prior)
+{
+    return visits > 0 ? total / visits : prior;
+}
+
+}  // namespace
+
+MctsBot::MctsBot(MctsOptions o) : options(o), arena(o.arenaBytes), engine(o.seed)
+{
+    options.maxDepth = std::clamp(options.maxDepth, 1, maxPlies);
+}
+
+Decision MctsBot::think(Game& game)
+{
+    if (game.isGameOver()) return Decision();
+    FeatureBoard board;
+    board.reset(game.getPlayfield().getGrid());
+    std::vector<Piece> upcoming;
+    for (const auto& piece : game.getUpcoming())
+        upcoming.push_back(piece->getPiece());
+    std::optional<Piece> held;
+    if (game.getCarryPiece()) held = game.getCarryPiece()->getPiece();
+    return think(board, game.getActivePiece().getPiece(), upcoming, held, game.canHold(),
+                 game.getBagLeft());
+}
+
+Decision MctsBot::think(const FeatureBoard& board, Piece active,
+                        const std::vector<Piece>& upcoming, std::optional<Piece> held,
+                        bool canHold, const std::vector<Piece>& bagLeft)
+{
+    auto start = std::chrono::steady_clock::now();
+    arena.reset();
+
+    Decision decision;
+    Node* root = arena.make<Node>();
+    if (!root) return decision;
+    root->board = board;
+    root->queue[0] = active;
+    root->queued = 1;
+    for (Piece piece : upcoming) {
+        if (root->queued == int(root->queue.size())) break;
+        root->queue[root->queued++] = piece;
+    }
+    root->held = held;
+    root->canHold = canHold;
+    for (Piece piece : bagLeft)
+        root->bag |= 1 << piece;
+    if (root->bag == 0) root->bag = wholeBag;
+    // the root is expanded whatever the time, there is no decision without its placements,
+    // but it counts against the budget
+    deadline = std::chrono::steady_clock::time_point::max();
+    if (!expand(root) || root->edgeCount == 0) return decision;
+    deadline = start + std::chrono::microseconds(options.budget);
+
+    // with a single placement there is nothing to think about. otherwise playouts go on while
+    // there is time left for the expansion most of them end with, and one that reaches the
+    // deadline in the middle of expanding a leaf gives up there
+    int deepest = 0;
+    if (root->edgeCount > 1) {
+        while (std::chrono::steady_clock::now() + expansion < deadline && playout(root, deepest))
+            decision.nodes++;
+    }
+
+    // the most visited placement, which is the one playouts trusted most
+    Edge* best = &root->edges[0];
+    for (int i = 1; i < root->edgeCount; i++) {
+        Edge& edge = root->edges[i];
+        if (edge.visits > best->visits
+            || (edge.visits == best->visits
+                && meanOf(edge.visits, edge.total, edge.prior)
+                       > meanOf(best->visits, best->total, best->prior)))
+            best = &edge;
+    }
+    decision.placement = best->placement;
+    decision.hold = best->hold;
+    decision.value = meanOf(best->visits, best->total, best->prior);
+    decision.depth = deepest;
+    decision.found = true;
+    return decision;
+}
+
+bool MctsBot::expand(Node* node)
+{
+    auto start = std::chrono::steady_clock::now();
+    PaddedBoard padded = pad(node->board);
+    // the placements of at most two pieces, without and with holding
+    std::array<bool, 2> holds = {false, true};
+    int kinds = 0;
+
+    // each search is a good part of a playout, so the clock is checked before every one
+    auto search = [&](Piece piece) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        placements(padded, piece, candidates[kinds++]);
+        return true;
+    };
+    Piece current = node->queue[0];
+    if (!search(current)) return false;
+    if (node->canHold) {
+        if (node->held) {
+            if (*node->held != current && !search(*node->held)) return false;
+        } else if (node->queued > 1) {
+            if (!search(node->queue[1])) return false;
+        }
+    }
+
+    // scoring every edge takes as long as the searches again
+    if (std::chrono::steady_clock::now() >= deadline) return false;
+    built.clear();
+    for (int k = 0; k < kinds; k++) {
+        for (const Placement& placement : candidates[k]) {
+            Edge edge;
+            BoardFeatures features = node->board.after(placement.cells());
+            edge.placement = placement;
+            edge.hold = holds[k];
+            edge.lost = features.toppedOut;
+            edge.reward = clearValue(options.weights, features, placement.spin);
+            edge.prior = edge.lost ? options.lossValue
+                                   : edge.reward + boardValue(options.weights, features);
+            built.push_back(edge);
+        }
+    }
+    // best prior first, in the order they were found among equals
+    int count = built.size();
+    order.resize(count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return built[a].prior > built[b].prior || (built[a].prior == built[b].prior && a < b);
+    });
+    Edge* edges = arena.make<Edge>(count);
+    if (!edges && count > 0) return false;
+    for (int i = 0; i < count; i++)
+        edges[i] = built[order[i]];
+    node->edges = edges;
+    node->edgeCount = count;
+    node->expanded = true;
+    // an average that follows the last few dozen expansions
+    expansion += (std::chrono::steady_clock::now() - start - expansion) / 16;
+    return true;
+}
+
+MctsBot::Edge* MctsBot::select(Node* node)
+{
+    int considered = std::min<int>(
+        node->edgeCount, 1 + int(options.widening * std::sqrt(float(node->visits))));
+    // values are in evaluation units, scaled to 0 to 1 between the worst and best child
+    // considered so the exploration term means the same on every board
+    float low = 0, high = 0;
+    for (int i = 0; i < considered; i++) {
+        const Edge& edge = node->edges[i];
+        float mean = meanOf(edge.visits, edge.total, edge.prior);
+        if (i == 0 || mean < low) low = mean;
+        if (i == 0 || mean > high) high = mean;
+    }
+    float scale = high > low ? 1 / (high - low) : 0;
+    float logVisits = std::log(float(node->visits + 1));
+    Edge* best = nullptr;
+    float bestScore = 0;
+    for (int i = 0; i < considered; i++) {
+        Edge& edge = node->edges[i];
+        float mean = meanOf(edge.visits, edge.total, edge.prior);
+        float score = (mean - low) * scale
+                      + options.exploration * std::sqrt(logVisits / (edge.visits + 1));
+        if (!best || score > bestScore) {
+            best = &edge;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+MctsBot::Node* MctsBot::childOf(const Node* node, const Edge& edge)
+{
+    Node* child = arena.make<Node>();
+    if (!child) return nullptr;
+    child->board = node->board;
+    child->board.add(edge.placement.cells());
+    child->board.clearLines();
+
+    // the pieces used up: the first, or the first two when holding brought the second in
+    int used = 1;
+    child->held = node->held;
+    if (edge.hold) {
+        child->held = node->queue[0];
+        if (!node->held) used = 2;
+    }
+    child->queued = node->queued - used;
+    std::copy(node->queue.begin() + used, node->queue.begin() + node->queued,
+              child->queue.begin());
+    child->canHold = true;
+    child->bag = node->bag;
+    child->depth = node->depth + 1;
+    return child;
+}
+
+MctsBot::Node* MctsBot::draw(Node* node)
+{
+    int left = std::popcount(node->bag);
+    int pick = std::uniform_int_distribution<int>(0, left - 1)(engine);
+    int piece = 0;
+    for (std::uint8_t bits = node->bag;; bits &= bits - 1) {
+        if (pick-- == 0) {
+            piece = std::countr_zero(bits);
+            break;
+        }
+    }
+    Node*& outcome = node->outcomes[piece];
+    if (outcome) return outcome;
+    outcome = arena.make<Node>();
+    if (!outcome) return nullptr;
+    outcome->board = node->board;
+    outcome->queue[0] = Piece(piece);
+    outcome->queued = 1;
+    outcome->held = node->held;
+    outcome->canHold = node->canHold;
+    outcome->bag = node->bag & ~(1 << piece);
+    if (outcome->bag == 0) outcome->bag = wholeBag;
+    outcome->depth = node->depth;
+    return outcome;
+}
+
+bool MctsBot::playout(Node* root, int& deepest)
+{
+    std::array<Node*, maxPlies> nodes;
+    std::array<Edge*, maxPlies> taken;
+    int steps = 0;
+    Node* node = root;
+    float value;
+    for (;;) {
+        if (node->queued == 0) {
+            node = draw(node);
+            if (!node) return false;
+            continue;
+        }
+        if (!node->expanded) {
+            if (!expand(node)) return false;
+            // a new leaf, worth the best of its placements
+            value = node->edgeCount > 0 ? node->edges[0].prior : options.lossValue;
+            break;
+        }
+        if (node->edgeCount == 0) {
+            value = options.lossValue;
+            break;
+        }
+        if (node->depth >= options.maxDepth) {
+            value = node->edges[0].prior;
+            break;
+        }
+        Edge* edge = select(node);
+        nodes[steps] = node;
+        taken[steps++] = edge;
+        if (edge->lost) {
+            value = options.lossValue;
+            break;
+        }
+        if (!edge->child) {
+            edge->child = childOf(node, *edge);
+            if (!edge->child) return false;
+        }
+        node = edge->child;
+    }
+    deepest = std::max(deepest, steps);
+
+    for (int i = steps - 1; i >= 0; i--) {
+        value += taken[i]->reward;
+        taken[i]->visits++;
+        taken[i]->total += value;
+        nodes[i]->visits++;
+    }
+    return true;
+}
@@ -0,0 +1,160 @@
+#ifndef MCTS_H_
+#define MCTS_H_
+
+#include "arena.hpp"
+#include "enums.hpp"
+#include "features.hpp"
+#include "game.hpp"
+#include "movegen.hpp"
+#include "search.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+// a Monte Carlo tree search bot for real time play, which thinks for a fixed time per piece
+// and can be stopped at any playout with the best move found so far
+//
+// a playout goes down the tree choosing placements by UCT, adds one node where it leaves the
+// tree and scores it by the best static evaluation of its placements, the same evaluation as
+// Bot. values are the rewards for lines cleared on the way plus that score. a node only
+// considers its best few placements by static value at first and more as it is visited
+// more. past the preview queue the next piece is unknown: the node there is a chance node,
+// which draws the piece from what is left of the 7-bag the generator is on, then from whole
+// bags, so the tree never plans for a piece the generator can not give
+//
+// the tree of a decision lives in an Arena, which is emptied in one go before the next one,
+// and expanding a node reuses the same scratch vectors, so once those have grown playouts
+// never allocate and thinking takes the same time for every piece
+
+struct MctsOptions
+{
+    // time to think about each piece, in microseconds. no playout starts without the time for
+    // one more expansion, and the clock is checked before every movegen search in one and
+    // before scoring its edges, so thinking ends at most one of those after it
+    int budget = 2000;
+
+    // memory for the tree of one decision, thinking stops early when it is full
+    std::size_t arenaBytes = std::size_t(64) << 20;
+
+    // how much playouts favour children that have been visited less
+    float exploration = 0.7f;
+
+    // children considered at a node, 1 more than this times the square root of its visits
+    float widening = 2.0f;
+
+    // placements a playout goes down at most
+    int maxDepth = 10;
+
+    Weights weights = defaultWeights;
+
+    // value of topping out, instead of the evaluation's, which would swamp every average
+    float lossValue = -1000;
+
+    unsigned int seed = 1;
+};
+
+class MctsBot
+{
+public:
+    explicit MctsBot(MctsOptions = MctsOptions());
+
+    // for the active piece of a game, which must not have moved since it spawned
+    Decision think(Game&);
+
+    // for a board, the active piece, the pieces after it, the hold slot and the pieces left
+    // in the bag after those (see Game::getBagLeft). the depth of the decision is the deepest
+    // playout and its nodes the number of playouts
+    Decision think(const FeatureBoard&, Piece active, const std::vector<Piece>& upcoming,
+                   std::optional<Piece> held, bool canHold, const std::vector<Piece>& bagLeft);
+
+private:
+    struct Node;
+
+    struct Edge
+    {
+        Placement placement;
+        bool hold = false;
+
+        // the placement topped out, which ends every playout through it
+        bool lost = false;
+
+        float reward = 0;
+
+        // the reward plus the static value of the board after, standing in for the value of
+        // the edge until it is visited
+        float prior = 0;
+
+        std::uint32_t visits = 0;
+        float total = 0;
+        Node* child = nullptr;
+    };
+
+    struct Node
+    {
+        FeatureBoard board;
+
+        // pieces known to be coming, the first being the one to place. none at a chance node
+        std::array<Piece, 8> queue = {};
+        int queued = 0;
+        std::optional<Piece> held;
+        bool canHold = true;
+
+        // pieces left in the bag the next unknown piece is drawn from, a bit per Piece
+        std::uint8_t bag = 0;
+
+        // placements from the root
+        int depth = 0;
+
+        std::uint32_t visits = 0;
+        bool expanded = false;
+
+        // placements, best static value first
+        Edge* edges = nullptr;
+        int edgeCount = 0;
+
+        // of a chance node, by the piece drawn
+        std::array<Node*, 7> outcomes = {};
+    };
+
+    static constexpr int maxPlies = 32;
+
+    MctsOptions options;
+    Arena arena;
+    std::mt19937 engine;
+
+    // of the decision under way
+    std::chrono::steady_clock::time_point deadline;
+
+    // how long expanding a node takes, a running average over decisions
+    std::chrono::steady_clock::duration expansion{0};
+
+    // scratch for expanding a node, kept so that expanding does not allocate once they have
+    // grown: the placements of each piece searched, and the edges before and after sorting
+    std::array<std::vector<Placement>, 2> candidates;
+    std::vector<Edge> built;
+    std::vector<int> order;
+
+    // add the placements of a node, false if the arena is full or time ran out first, which
+    // leaves the node as it was
+    bool expand(Node*);
+
+    // the edge a playout takes from a node
+    Edge* select(Node*);
+
+    // the node after a placement, nullptr if the arena is full
+    Node* childOf(const Node*, const Edge&);
+
+    // the node after drawing a piece at a chance node, nullptr if the arena is full
+    Node* draw(Node*);
+
+    // one playout from the root, false if the arena is full or time ran out, in which case
+    // nothing it went through is counted
+    bool playout(Node* root, int& deepest);
+};
+
+#endif  // MCTS_H_
@@ -0,0 +1,345 @@
+#include "movegen.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+
+namespace {
+
+struct State
+{
+    int r;
+    int x;
+    int y;
+    Spin spin;
+};
+
+// states are numbered for the visited set and the links back in pathTo. only a T that has
+// just rotated has a spin, every other state is NoSpin
+constexpr int columnSlots = 32;
+constexpr int stateCount = 3 * 4 * boardRows * columnSlots;
+
+int indexOf(const State& s)
+{
+    return ((s.spin * 4 + s.r) * boardRows + s.y + boardPadY) * columnSlots + s.x + boardPadX;
+}
+
+State stateAt(int index)
+{
+    State s;
+    s.x = index % columnSlots - boardPadX;
+    index /= columnSlots;
+    s.y = index % boardRows - boardPadY;
+    index /= boardRows;
+    s.r = index % 4;
+    s.spin = Spin(index / 4);
+    return s;
+}
+
+bool collides(const PaddedBoard& board, const PieceShape& shape, int r, int x, int y)
+{
+    int shift = x + shape.left[r] + boardPadX;
+    int base = y + shape.bottom[r] + boardPadY;
+    // past the padding, which only a piece kicked well through a wall could reach
+    if (shift < 0 || shift + 4 > 32 || base < 0 || base + 4 > boardRows) return true;
+    std::uint32_t hit = 0;
+    for (int i = 0; i < 4; i++)
+        hit |= board[base + i] & (shape.rows[r][i] << shift);
+    return hit != 0;
+}
+
+bool full(const PaddedBoard& board, int x, int y)
+{
+    x += boardPadX;
+    y += boardPadY;
+    if (x < 0 || x >= 32 || y < 0 || y >= boardRows) return true;
+    return (board[y] >> x) & 1;
+}
+
+// as Game::activeSpin, for a T that has just rotated into a position with a kick
+Spin spinAt(const PaddedBoard& board, Piece piece, int r, int x, int y, int kick)
+{
+    if (piece != T) return NoSpin;
+    int corners = full(board, x - 1, y + 1) * TopLeft | full(board, x + 1, y + 1) * TopRight
+                  | full(board, x + 1, y - 1) * BottomRight
+                  | full(board, x - 1, y - 1) * BottomLeft;
+    return spinFromCorners(r, corners, kick);
+}
+
+// the visited set and queue of a search, kept per thread since bots search on many. a state
+// is visited when it has the stamp of the current search, so nothing needs clearing between.
+// keys are the squares of the placements found so far, emptied by each search that uses them
+struct Scratch
+{
+    std::vector<std::uint32_t> visited = std::vector<std::uint32_t>(stateCount);
+    std::vector<int> queue = std::vector<int>(stateCount);
+    std::uint32_t stamp = 0;
+    std::vector<std::uint64_t> keys;
+};
+
+thread_local Scratch scratch;
+
+// breadth first over every state a piece can reach from its spawn, calling reached(state,
+// from, action) once for each new state, from being -1 for the spawn. with a row to start
+// from, it starts from every rotation and column with the piece's lowest square on that row
+// instead, which takes a board empty from a little below that row up
+template <typename Reached>
+void explore(const PaddedBoard& board, Piece piece, Reached reached, int start = -1)
+{
+    const PieceShape& shape = shapeOf(piece);
+    if (++scratch.stamp == 0) {
+        std::fill(scratch.visited.begin(), scratch.visited.end(), 0);
+        scratch.stamp = 1;
+    }
+    std::uint32_t stamp = scratch.stamp;
+    std::vector<std::uint32_t>& visited = scratch.visited;
+    std::vector<int>& queue = scratch.queue;
+    int head = 0, tail = 0;
+
+    auto visit = [&](const State& s, int from, Action action) {
+        int index = indexOf(s);
+        if (visited[index] == stamp) return;
+        visited[index] = stamp;
+        queue[tail++] = index;
+        reached(s, from, action);
+    };
+
+    if (start < 0) {
+        // the spawn may overlap the rows above the board, moves out of it are still checked
+        visit({0, shape.spawn.first, shape.spawn.second, NoSpin}, -1, ActionNone);
+    } else {
+        for (int r = 0; r < 4; r++) {
+            for (int x = -boardPadX; x < columnSlots - boardPadX; x++) {
+                if (!collides(board, shape, r, x, start - shape.bottom[r]))
+                    visit({r, x, start - shape.bottom[r], NoSpin}, -1, ActionNone);
+            }
+        }
+    }
+    while (head < tail) {
+        int from = queue[head++];
+        State s = stateAt(from);
+        for (int dx : {-1, 1}) {
+            if (!collides(board, shape, s.r, s.x + dx, s.y))
+                visit({s.r, s.x + dx, s.y, NoSpin}, from, dx < 0 ? ActionLeft : ActionRight);
+        }
+        for (Rotation rotation : {Clockwise, CounterClockwise}) {
+            int to = rotation == Clockwise ? (s.r + 1) % 4 : (s.r + 3) % 4;
+            for (int k = 0; k < 5; k++) {
+                auto kick = shape.kicks[s.r][rotation][k];
+                int x = s.x + kick.first, y = s.y + kick.second;
+                if (collides(board, shape, to, x, y)) continue;
+                visit({to, x, y, spinAt(board, piece, to, x, y, k)}, from,
+                      rotation == Clockwise ? ActionClockwise : ActionCounterClockwise);
+                break;
+            }
+        }
+        if (!collides(board, shape, s.r, s.x, s.y - 1))
+            visit({s.r, s.x, s.y - 1, NoSpin}, from, ActionSoftdrop);
+    }
+}
+
+// the origin in each rotation, if any, that covers the same squares as a placement
+typedef std::array<std::optional<std::pair<int, int>>, 4> Origins;
+
+Origins originsOf(const Placement& target)
+{
+    const PieceShape& shape = shapeOf(target.piece);
+    FeatureBoard::Squares cells = target.cells();
+    std::sort(cells.begin(), cells.end());
+    Origins origins;
+    for (int r = 0; r < 4; r++) {
+        FeatureBoard::Squares layout = shape.layouts[r];
+        std::sort(layout.begin(), layout.end());
+        int dx = cells[0].first - layout[0].first, dy = cells[0].second - layout[0].second;
+        bool same = true;
+        for (int i = 0; i < 4; i++) {
+            same = same && cells[i].first == layout[i].first + dx
+                   && cells[i].second == layout[i].second + dy;
+        }
+        if (same) origins[r] = std::make_pair(dx, dy);
+    }
+    return origins;
+}
+
+// whether a harddrop from a state locks the piece on the squares of a target with its spin. a
+// piece that falls on the way has moved since it last rotated, so it is never a spin
+bool dropsOnto(const PaddedBoard& board, const PieceShape& shape, const State& s,
+               const Origins& origins, Spin spin)
+{
+    const auto& origin = origins[s.r];
+    if (!origin || s.x != origin->first || s.y < origin->second) return false;
+    if (!collides(board, shape, s.r, s.x, origin->second - 1)) return false;
+    if (s.y == origin->second) return s.spin == spin;
+    if (spin != NoSpin) return false;
+    for (int y = s.y - 1; y >= origin->second; y--) {
+        if (collides(board, shape, s.r, s.x, y)) return false;
+    }
+    return true;
+}
+
+// whether inputs take a freshly spawned piece to the squares of a target with its spin, the
+// same way a Game would move it
+bool reaches(const PaddedBoard& board, const Placement& target, const std::vector<Action>& path)
+{
+    const PieceShape& shape = shapeOf(target.piece);
+    // the spawn overlaps the rows above the board, as in explore
+    State s = {0, shape.spawn.first, shape.spawn.second, NoSpin};
+    for (Action action : path) {
+        switch (action) {
+        case ActionLeft:
+        case ActionRight: {
+            int x = s.x + (action == ActionLeft ? -1 : 1);
+            if (collides(board, shape, s.r, x, s.y)) return false;
+            s = {s.r, x, s.y, NoSpin};
+            break;
+        }
+        case ActionClockwise:
+        case ActionCounterClockwise: {
+            Rotation rotation = action == ActionClockwise ? Clockwise : CounterClockwise;
+            int to = rotation == Clockwise ? (s.r + 1) % 4 : (s.r + 3) % 4;
+            int k = 0;
+            for (; k < 5; k++) {
+                auto kick = shape.kicks[s.r][rotation][k];
+                if (!collides(board, shape, to, s.x + kick.first, s.y + kick.second)) break;
+            }
+            if (k == 5) return false;
+            auto kick = shape.kicks[s.r][rotation][k];
+            int x = s.x + kick.first, y = s.y + kick.second;
+            s = {to, x, y, spinAt(board, target.piece, to, x, y, k)};
+            break;
+        }
+        case ActionSoftdrop:
+            if (collides(board, shape, s.r, s.x, s.y - 1)) return false;
+            s = {s.r, s.x, s.y - 1, NoSpin};
+            break;
+        case ActionHarddrop: return dropsOnto(board, shape, s, originsOf(target), target.spin);
+        default: return false;
+        }
+    }
+    return false;
+}
+
+// the inputs of finesse, by piece, rotation and column of origin plus boardPadX
+typedef std::array<std::array<std::array<std::vector<Action>, columnSlots>, 4>, 7> FinesseTable;
+
+const FinesseTable& finesseTable()
+{
+    // worked out once, by the breadth first search of pathTo on an empty board
+    static const FinesseTable table = [] {
+        FinesseTable paths;
+        PaddedBoard empty = pad(FeatureBoard());
+        for (int p = 0; p < 7; p++) {
+            const PieceShape& shape = shapeOf(Piece(p));
+            for (int r = 0; r < 4; r++) {
+                for (int slot = 0; slot < columnSlots; slot++) {
+                    int x = slot - boardPadX, y = -shape.bottom[r];
+                    if (!collides(empty, shape, r, x, y))
+                        paths[p][r][slot] = pathTo(empty, {Piece(p), r, x, y, NoSpin});
+                }
+            }
+        }
+        return paths;
+    }();
+    return table;
+}
+
+// the squares a placement covers, as bits of padded rows above its lowest row, for telling
+// apart placements that differ only in rotation or origin
+std::uint64_t coverKey(const PieceShape& shape, int r, int x, int y)
+{
+    static_assert(WIDTH <= 14 && boardRows <= 64, "a cover has to fit 64 bits");
+    std::uint64_t key = y + shape.bottom[r] + boardPadY;
+    for (int i = 0; i < 4; i++)
+        key |= std::uint64_t(shape.rows[r][i] << (x + shape.left[r])) << (6 + 14 * i);
+    return key;
+}
+
+}  // namespace
+
+FeatureBoard::Squares Placement::cells() const
+{
+    FeatureBoard::Squares squares;
+    const auto& layout = shapeOf(piece).layouts[rotation];
+    for (int i = 0; i < 4; i++)
+        squares[i] = {x + layout[i].first, y + layout[i].second};
+    return squares;
+}
+
+PaddedBoard pad(const FeatureBoard& board)
+{
+    PaddedBoard padded;
+    padded.fill(fullRow);
+    const FeatureBoard::Rows& rows = board.getRows();
+    for (int y = 0; y < HEIGHT; y++)
+        padded[y + boardPadY] = (rows[y] << boardPadX) | wallRow;
+    return padded;
+}
+
+void placements(const PaddedBoard& board, Piece piece, std::vector<Placement>& out)
+{
+    placementsBelow(board, piece, HEIGHT, out);
+}
+
+void placementsBelow(const PaddedBoard& board, Piece piece, int height,
+                     std::vector<Placement>& out)
+{
+    out.clear();
+    const PieceShape& shape = shapeOf(piece);
+    // a rotation with its kick drops a piece 4 rows at most, so no one move from above the
+    // start reaches the stack, and whatever a piece does up there it can do from the start.
+    // boards too high for that, with the start too near the spawn, search from the spawn
+    int start = height + 4;
+    if (start + 4 > HEIGHT) start = -1;
+    std::vector<std::uint64_t>& keys = scratch.keys;
+    keys.clear();
+    explore(board, piece, [&](const State& s, int, Action) {
+        if (!collides(board, shape, s.r, s.x, s.y - 1)) return;
+        std::uint64_t key = coverKey(shape, s.r, s.x, s.y);
+        auto same = std::find(keys.begin(), keys.end(), key);
+        if (same != keys.end()) {
+            // the same squares, a T reached some other way may be a better spin
+            Placement& found = out[same - keys.begin()];
+            if (s.spin > found.spin) found = {piece, s.r, s.x, s.y, s.spin};
+            return;
+        }
+        keys.push_back(key);
+        out.push_back({piece, s.r, s.x, s.y, s.spin});
+    }, start);
+}
+
+std::vector<Action> pathTo(const PaddedBoard& board, const Placement& target)
+{
+    const PieceShape& shape = shapeOf(target.piece);
+    Origins origins = originsOf(target);
+    auto from = std::make_unique<int[]>(stateCount);
+    auto by = std::make_unique<Action[]>(stateCount);
+    int goal = -1;
+    explore(board, target.piece, [&](const State& s, int parent, Action action) {
+        int index = indexOf(s);
+        from[index] = parent;
+        by[index] = action;
+        if (goal < 0 && dropsOnto(board, shape, s, origins, target.spin)) goal = index;
+    });
+    std::vector<Action> path;
+    if (goal < 0) return path;
+    path.push_back(ActionHarddrop);
+    for (int at = goal; from[at] >= 0; at = from[at])
+        path.push_back(by[at]);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+const std::vector<Action>& finesse(Piece piece, int rotation, int x)
+{
+    static const std::vector<Action> none;
+    int slot = x + boardPadX;
+    if (rotation < 0 || rotation >= 4 || slot < 0 || slot >= columnSlots) return none;
+    return finesseTable()[piece][rotation][slot];
+}
+
+std::vector<Action> planInputs(const PaddedBoard& board, const Placement& target)
+{
+    const std::vector<Action>& open = finesse(target.piece, target.rotation, target.x);
+    if (!open.empty() && reaches(board, target, open)) return open;
+    return pathTo(board, target);
+}
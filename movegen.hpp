@@ -0,0 +1,73 @@
+#ifndef MOVEGEN_H_
+#define MOVEGEN_H_
+
+#include "dimensions.hpp"
+#include "enums.hpp"
+#include "features.hpp"
+#include "scoring.hpp"
+#include "shapes.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// every place a piece can be locked, found by trying moves from its spawn position on a
+// bitboard, for bots
+//
+// the moves are the player's: left, right, both rotations with the SRS kicks and softdrop,
+// checked against the same walls, floor and top as Playfield::squareFull, so anything found
+// here can be reached in a Game with the inputs from pathTo or planInputs. a piece spawns
+// partly above the board, which counts as full, and has to fall before it can move sideways,
+// as in a Game
+
+struct Placement
+{
+    Piece piece = I;
+    int rotation = 0;
+
+    // origin, as Tetromino::getOrigin
+    int x = 0;
+    int y = 0;
+
+    // whether a T got there with a rotation that makes it a T-spin, see spinFromCorners
+    Spin spin = NoSpin;
+
+    // the squares it covers
+    FeatureBoard::Squares cells() const;
+};
+
+// a board in the padded layout of shapes.hpp, walls, floor and top set
+typedef std::array<std::uint32_t, boardRows> PaddedBoard;
+
+PaddedBoard pad(const FeatureBoard&);
+
+// every distinct placement of a piece, appended to out after clearing it. placements that
+// cover the same squares are only listed once
+void placements(const PaddedBoard&, Piece, std::vector<Placement>& out);
+
+// the same placements for a board with nothing at or above a row, searched from just above
+// that row in every rotation and column, which the piece can all get to through the open
+// air, instead of from the spawn. much less to search when the stack is low
+void placementsBelow(const PaddedBoard&, Piece, int height, std::vector<Placement>& out);
+
+// the fewest inputs taking a freshly spawned piece to the squares of a placement and locking
+// it there with its spin, the last one always a harddrop, found by a breadth first search.
+// the piece may end in another rotation that covers the same squares, as an S flipped either
+// way does. empty if the placement can not be reached
+std::vector<Action> pathTo(const PaddedBoard&, const Placement&);
+
+// the fewest inputs for a placement on an empty board, from a table worked out on first use.
+// the board only decides how far the harddrop at the end falls, so these are the inputs for
+// a rotation and column on any board with open air above the stack, and what a player is held
+// to there. empty if the piece does not fit in that rotation and column
+const std::vector<Action>& finesse(Piece, int rotation, int x);
+
+// the inputs for a placement, taken from the finesse table when they work on this board,
+// which they do unless the stack is in the way, and from pathTo when they do not. a kick off
+// the stack now and then makes pathTo one input shorter than the table, which finesse does
+// not count. the inputs are the ones Game::apply and the frontends take, so bots play with a
+// player's keys and a finesse trainer can hold a player's inputs against these
+std::vector<Action> planInputs(const PaddedBoard&, const Placement&);
+
+#endif  // MOVEGEN_H_
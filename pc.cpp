@@ -0,0 +1,160 @@
+#include "features.hpp"
+#include "game.hpp"
+#include "movegen.hpp"
+#include "perfect.hpp"
+#include "search.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+// plays seeded games with the lookahead bot of search.hpp and asks the solver for a perfect
+// clear before every piece the stack is low enough for. a clear it finds is played out in
+// place of the bot's moves, and the board is checked after every step, so a solution the
+// inputs do not reach shows up at once. a solution stops before the pieces past the preview,
+// so the solver runs again once they come into it, and a guaranteed clear that stops working
+// on the way shows up then
+//
+// by default a solution has to work whatever pieces come after the preview, -p asks for one
+// that works for some of them. -t is the bot's budget per piece
+//
+//   tetris-pc [-p] [-l lines] [-b budget ms] [-t bot ms] [-k games] [-n pieces] [-j threads]
+//             [-s seed]
+
+namespace {
+
+// whether nothing is on or above a row
+bool lowerThan(const FeatureBoard& board, int lines)
+{
+    for (int y = lines; y < HEIGHT; y++) {
+        if (board.getRows()[y]) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    PerfectClearOptions options;
+    BotOptions botOptions;
+    botOptions.budget = 5;
+    int games = 3;
+    int pieces = 300;
+    unsigned int seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "pl:b:t:k:n:j:s:")) != -1) {
+        switch (opt) {
+        case 'p': options.guaranteed = false; break;
+        case 'l': options.lines = std::atoi(optarg); break;
+        case 'b': options.budget = std::atoi(optarg); break;
+        case 't': botOptions.budget = std::atoi(optarg); break;
+        case 'k': games = std::atoi(optarg); break;
+        case 'n': pieces = std::atoi(optarg); break;
+        case 'j': options.threads = botOptions.threads = std::atoi(optarg); break;
+        case 's': seed = std::strtoul(optarg, nullptr, 10); break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-p] [-l lines] [-b budget ms] [-t bot ms]"
+                      << " [-k games] [-n pieces] [-j threads] [-s seed]" << std::endl;
+            return -1;
+        }
+    }
+    if (options.lines <= 0 || options.lines > PerfectClearSolver::maxLines || options.budget <= 0
+        || botOptions.budget <= 0 || games <= 0 || pieces <= 0 || options.threads < 0)
+        return -1;
+
+    PerfectClearSolver solver(options);
+    Bot bot(botOptions);
+    int cleared = 0, found = 0, stopped = 0;
+    std::uint64_t nodes = 0;
+    std::vector<double> times;
+    for (int g = 0; g < games; g++) {
+        // no ticks, so nothing locks before the harddrop
+        Game game(seed + g, DelayLock);
+        int placed = 0, clears = 0;
+        // the steps of a guaranteed clear were played, so the next solve has to find the rest
+        bool promised = false;
+        while (placed < pieces && !game.isGameOver()) {
+            FeatureBoard board;
+            board.reset(game.getPlayfield().getGrid());
+            std::vector<PerfectClearStep> steps;
+            bool complete = false;
+            if (lowerThan(board, options.lines)) {
+                auto before = std::chrono::steady_clock::now();
+                PerfectClear clear = solver.solve(game);
+                std::chrono::duration<double> time = std::chrono::steady_clock::now() - before;
+                times.push_back(time.count());
+                nodes += clear.nodes;
+                stopped += clear.stopped;
+                found += clear.found;
+                if (promised && !clear.found && !clear.stopped) {
+                    std::cerr << "game " << seed + g << ": a guaranteed clear did not work out"
+                              << std::endl;
+                    return 1;
+                }
+                if (clear.found) steps = clear.steps;
+                complete = clear.complete;
+                promised = options.guaranteed && !steps.empty() && !complete;
+            }
+            if (steps.empty()) {
+                Decision decision = bot.think(game);
+                if (!decision.found) break;
+                steps.push_back({decision.placement, decision.hold});
+            }
+
+            for (const PerfectClearStep& step : steps) {
+                FeatureBoard expected;
+                expected.reset(game.getPlayfield().getGrid());
+                auto path = planInputs(pad(expected), step.placement);
+                if (path.empty()) {
+                    std::cerr << "game " << seed + g << ": no path to a placement" << std::endl;
+                    return 1;
+                }
+                if (step.hold) game.hold();
+                for (Action action : path)
+                    game.apply(action);
+                placed++;
+
+                expected.add(step.placement.cells());
+                expected.clearLines();
+                if (game.isGameOver()) break;
+                FeatureBoard actual;
+                actual.reset(game.getPlayfield().getGrid());
+                if (actual.getRows() != expected.getRows()) {
+                    std::cerr << "game " << seed + g << ": the board is not the one the steps"
+                              << " lead to" << std::endl;
+                    return 1;
+                }
+            }
+            if (complete) {
+                FeatureBoard after;
+                after.reset(game.getPlayfield().getGrid());
+                if (game.isGameOver() || after.getFeatures().aggregateHeight != 0) {
+                    std::cerr << "game " << seed + g << ": the steps of a clear left squares"
+                              << std::endl;
+                    return 1;
+                }
+                clears++;
+            }
+        }
+        std::cout << "game " << seed + g << ": " << clears << " perfect clears in " << placed
+                  << " pieces" << (game.isGameOver() ? ", topped out" : "") << std::endl;
+        cleared += clears;
+    }
+    std::sort(times.begin(), times.end());
+    double mean = 0;
+    for (double time : times)
+        mean += time / times.size();
+    double p99 = times.empty() ? 0 : times[times.size() * 99 / 100];
+    double slowest = times.empty() ? 0 : times.back();
+
+    std::cout << cleared << " perfect clears, " << times.size() << " solves, " << found
+              << " found, " << stopped << " out of time, " << nodes << " nodes" << std::endl;
+    std::cout << "solves mean " << mean * 1000 << " ms, p99 " << p99 * 1000 << " ms, slowest "
+              << slowest * 1000 << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,337 @@
+#include "perfect.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+namespace {
+
+constexpr std::uint16_t fullLine = (1u << WIDTH) - 1;
+constexpr std::uint8_t wholeBag = 0x7f;
+
+static_assert(WIDTH <= 16, "rows are 16 bit masks");
+
+std::uint64_t mix(std::uint64_t hash, std::uint64_t value)
+{
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+// add a placement to the rows and clear what it fills, false if it is not all below height
+template <std::size_t N>
+bool place(std::array<std::uint16_t, N>& rows, int& height, const Placement& placement)
+{
+    auto cells = placement.cells();
+    for (auto cell : cells) {
+        if (cell.second < 0 || cell.second >= height) return false;
+    }
+    for (auto cell : cells)
+        rows[cell.second] |= 1u << cell.first;
+    int kept = 0;
+    for (int y = 0; y < height; y++) {
+        if (rows[y] != fullLine) rows[kept++] = rows[y];
+    }
+    for (int y = kept; y < height; y++)
+        rows[y] = 0;
+    height = kept;
+    return true;
+}
+
+typedef std::array<std::uint16_t, PerfectClearSolver::maxLines> Rows;
+
+int filled(const Rows& rows, int height)
+{
+    int count = 0;
+    for (int y = 0; y < height; y++)
+        count += std::popcount(rows[y]);
+    return count;
+}
+
+// the rows above the ones left are empty, pieces come down through them
+PaddedBoard padRows(const Rows& rows, int height)
+{
+    PaddedBoard padded;
+    padded.fill(fullRow);
+    for (int y = 0; y < HEIGHT; y++) {
+        std::uint32_t row = y < height ? rows[y] : 0;
+        padded[y + boardPadY] = row << boardPadX | wallRow;
+    }
+    return padded;
+}
+
+// whether rows can not be cleared, whatever pieces come. every row up to the highest square
+// is held up by the ones under it, so a clear takes them all and stays within the rows it
+// clears, which can be any number from those up to the height. for each, the empty squares in
+// them have to be a multiple of 4, and no piece can cross a column that is full all the way
+// up them, so the empty squares between two of those have to be as well
+bool hopeless(const Rows& rows, int height)
+{
+    int top = height;
+    while (top > 0 && rows[top - 1] == 0)
+        top--;
+    int squares = filled(rows, height);
+    for (int lines = std::max(top, 1); lines <= height; lines++) {
+        if ((lines * WIDTH - squares) % 4) continue;
+        std::uint16_t fullColumns = fullLine;
+        for (int y = 0; y < lines; y++)
+            fullColumns &= rows[y];
+        bool fits = true;
+        int between = 0;
+        for (int x = 0; x <= WIDTH && fits; x++) {
+            if (x == WIDTH || (fullColumns >> x & 1)) {
+                fits = between % 4 == 0;
+                between = 0;
+                continue;
+            }
+            for (int y = 0; y < lines; y++)
+                between += !(rows[y] >> x & 1);
+        }
+        if (fits) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+PerfectClearSolver::PerfectClearSolver(PerfectClearOptions o)
+  : options(o), pool(o.threads), outcomes(o.tableSize)
+{
+    options.lines = std::clamp(options.lines, 1, maxLines);
+}
+
+PerfectClear PerfectClearSolver::solve(Game& game)
+{
+    if (game.isGameOver()) return PerfectClear();
+    FeatureBoard board;
+    board.reset(game.getPlayfield().getGrid());
+    std::vector<Piece> upcoming;
+    for (const auto& piece : game.getUpcoming())
+        upcoming.push_back(piece->getPiece());
+    std::optional<Piece> held;
+    if (game.getCarryPiece()) held = game.getCarryPiece()->getPiece();
+    return solve(board, game.getActivePiece().getPiece(), upcoming, held, game.canHold(),
+                 game.getBagLeft());
+}
+
+PerfectClear PerfectClearSolver::solve(const FeatureBoard& board, Piece active,
+                                       const std::vector<Piece>& upcoming,
+                                       std::optional<Piece> held, bool canHold,
+                                       const std::vector<Piece>& bagLeft)
+{
+    PerfectClear result;
+    State root;
+    const FeatureBoard::Rows& rows = board.getRows();
+    for (int y = 0; y < HEIGHT; y++) {
+        if (y < options.lines)
+            root.rows[y] = rows[y];
+        else if (rows[y])
+            return result;
+    }
+    root.height = options.lines;
+    root.queue[0] = active;
+    root.queued = 1;
+    for (Piece piece : upcoming) {
+        if (root.queued == int(root.queue.size())) break;
+        root.queue[root.queued++] = piece;
+    }
+    root.held = held;
+    root.canHold = canHold;
+    for (Piece piece : bagLeft)
+        root.bag |= 1 << piece;
+    if (root.bag == 0) root.bag = wholeBag;
+
+    window = root.queued;
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.budget);
+    stopped = false;
+    nodes = 0;
+    solvedBy = INT_MAX;
+    for (auto& count : settled)
+        count = 0;
+    if (hopeless(root.rows, root.height)) return result;
+    std::vector<Move> first;
+    moves(root, first);
+    std::vector<std::vector<PerfectClearStep>> found(first.size());
+    pool.parallelFor(first.size(), [&](int i) {
+        const Move& move = first[i];
+        if (move.placed) found[i].push_back(move.step);
+        if (!search(move.next, i, move.placed, found[i])) return;
+        int seen = solvedBy.load();
+        while (i < seen && !solvedBy.compare_exchange_weak(seen, i))
+            ;
+    });
+    result.nodes = nodes.load();
+    result.stopped = stopped.load();
+    int best = solvedBy.load();
+    if (best == INT_MAX) return result;
+
+    result.found = true;
+    result.steps = found[best];
+    // the steps do it alone if playing them leaves no squares
+    Rows cleared = root.rows;
+    int height = root.height;
+    for (const PerfectClearStep& step : result.steps)
+        place(cleared, height, step.placement);
+    result.complete = filled(cleared, height) == 0;
+    return result;
+}
+
+void PerfectClearSolver::moves(const State& s, std::vector<Move>& out)
+{
+    out.clear();
+    PaddedBoard padded = padRows(s.rows, s.height);
+    std::vector<Placement> found;
+    auto add = [&](Piece piece, bool hold, const State& base) {
+        placementsBelow(padded, piece, s.height, found);
+        for (const Placement& placement : found) {
+            Move move{{placement, hold}, base, true};
+            if (place(move.next.rows, move.next.height, placement)) out.push_back(move);
+        }
+    };
+    auto after = [&](int used) {
+        State next = s;
+        std::copy(s.queue.begin() + used, s.queue.begin() + s.queued, next.queue.begin());
+        next.queued = s.queued - used;
+        next.canHold = true;
+        return next;
+    };
+
+    Piece current = s.queue[0];
+    add(current, false, after(1));
+    if (s.canHold) {
+        if (s.held) {
+            if (*s.held != current) {
+                State base = after(1);
+                base.held = current;
+                add(*s.held, true, base);
+            }
+        } else if (s.queued > 1) {
+            State base = after(2);
+            base.held = current;
+            add(s.queue[1], true, base);
+        } else {
+            // the piece holding brings in is not known yet, it is drawn first
+            State next = after(1);
+            next.held = current;
+            next.canHold = false;
+            Move move;
+            move.step.hold = true;
+            move.next = next;
+            move.placed = false;
+            out.push_back(move);
+        }
+    }
+    // low placements first, a perfect clear fills the board from the bottom
+    auto lowness = [](const Move& move) {
+        int sum = 0;
+        for (auto cell : move.step.placement.cells())
+            sum += cell.second;
+        return sum;
+    };
+    std::stable_sort(out.begin(), out.end(),
+                     [&](const Move& a, const Move& b) { return lowness(a) < lowness(b); });
+}
+
+bool PerfectClearSolver::search(const State& s, int job, bool known,
+                                std::vector<PerfectClearStep>& steps)
+{
+    if (!keepGoing(job)) return false;
+    // below the root a board with no squares is clear, however many rows that took
+    if (filled(s.rows, s.height) == 0) return true;
+    if (hopeless(s.rows, s.height)) return false;
+    // a position known to work is only taken from the table when its steps are not wanted
+    std::uint64_t key = keyOf(s);
+    float seen;
+    if (outcomes.probe(key, 0, seen) && (seen == 0 || !known)) return seen != 0;
+
+    bool solved = false;
+    int needed = (s.height * WIDTH - filled(s.rows, s.height)) / 4;
+    if (s.queued == 0 || (s.queued < window && s.queued + bool(s.held) < needed)) {
+        // a piece comes into the preview, unless the ones there and in hold are enough, and
+        // the moves after can depend on it: every piece the bag can give has to work, or one
+        solved = options.guaranteed;
+        // draws already known to decide it settle it without searching the others, and the
+        // rest go the way that has settled it most often, failures first when every draw has
+        // to work
+        std::array<State, 7> draws;
+        int count = 0;
+        for (std::uint8_t bits = s.bag; bits; bits &= bits - 1) {
+            int piece = std::countr_zero(bits);
+            State& next = draws[count];
+            next = s;
+            next.queue[next.queued++] = Piece(piece);
+            next.bag = s.bag & ~(1 << piece);
+            if (next.bag == 0) next.bag = wholeBag;
+            bool works;
+            if (hopeless(next.rows, next.height))
+                works = false;
+            else if (outcomes.probe(keyOf(next), 0, seen))
+                works = seen != 0;
+            else {
+                count++;
+                continue;
+            }
+            if (works != options.guaranteed) {
+                outcomes.store(key, 0, works);
+                return works;
+            }
+        }
+        auto settles = [&](const State& draw) {
+            return settled[draw.queue[draw.queued - 1]].load(std::memory_order_relaxed);
+        };
+        std::stable_sort(draws.begin(), draws.begin() + count,
+                         [&](const State& a, const State& b) { return settles(a) > settles(b); });
+        std::vector<PerfectClearStep> unknown;
+        for (int i = 0; i < count; i++) {
+            bool works = search(draws[i], job, false, unknown);
+            if (cancelled(job)) return false;
+            if (works != options.guaranteed) {
+                settled[draws[i].queue[draws[i].queued - 1]]++;
+                solved = works;
+                break;
+            }
+        }
+    } else {
+        std::vector<Move> next;
+        moves(s, next);
+        for (const Move& move : next) {
+            bool record = known && move.placed;
+            if (record) steps.push_back(move.step);
+            if (search(move.next, job, record, steps)) {
+                solved = true;
+                break;
+            }
+            if (record) steps.pop_back();
+            if (cancelled(job)) return false;
+        }
+    }
+    outcomes.store(key, 0, solved);
+    return solved;
+}
+
+bool PerfectClearSolver::keepGoing(int job)
+{
+    // every node, a node is a movegen search or more and the clock is nothing next to it
+    nodes.fetch_add(1, std::memory_order_relaxed);
+    if (std::chrono::steady_clock::now() >= deadline) stopped = true;
+    return !cancelled(job);
+}
+
+bool PerfectClearSolver::cancelled(int job)
+{
+    return solvedBy.load(std::memory_order_relaxed) < job
+           || stopped.load(std::memory_order_relaxed);
+}
+
+std::uint64_t PerfectClearSolver::keyOf(const State& s)
+{
+    std::uint64_t hash = mix(s.height, options.guaranteed);
+    hash = mix(hash, window);
+    for (int y = 0; y < s.height; y++)
+        hash = mix(hash, s.rows[y]);
+    hash = mix(hash, s.queued);
+    for (int i = 0; i < s.queued; i++)
+        hash = mix(hash, s.queue[i]);
+    hash = mix(hash, s.held ? *s.held + 1 : 0);
+    hash = mix(hash, s.canHold);
+    return mix(hash, s.bag);
+}
@@ -0,0 +1,167 @@
+#ifndef PERFECT_H_
+#define PERFECT_H_
+
+#include "enums.hpp"
+#include "features.hpp"
+#include "game.hpp"
+#include "movegen.hpp"
+#include "pool.hpp"
+#include "transposition.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// finds a way to clear the board completely within its bottom few rows
+//
+// the search is depth first over the rows that are left, as 16 bit masks. a placement is a
+// move of movegen.hpp that stays below the limit, full rows clear and the limit comes down
+// with them, and the board is clear when no squares are left, which can take fewer rows than
+// the limit. each position is first checked for things that rule it out whatever comes next:
+// for some number of rows from the highest square up to the limit, the empty squares in them
+// must be a multiple of 4, and no piece can cross a column that is full all the way up them,
+// so the empty squares between two of those must be a multiple of 4 too. what positions come
+// to is kept in a TranspositionTable, so the many orders that reach the same one are only
+// searched once, by every thread
+//
+// pieces past the queue are not known. as pieces are placed the solver draws new ones into
+// the queue, as the preview would show them, from what is left of the bag the generator is
+// on and then from whole bags, and either needs every piece it can draw to work out
+// (guaranteed) or just one (possible). moves after a draw can depend on what was drawn. draws
+// the checks or the table already settle are looked at first, and the rest are searched in
+// the order of the pieces that have most often decided a draw before
+//
+// the placements of one move at the root are searched as separate jobs on a ThreadPool, and
+// the first move in order that works is the answer, so the answer does not depend on the
+// number of threads unless the budget runs out first
+
+struct PerfectClearOptions
+{
+    // rows from the bottom to clear within, at most PerfectClearSolver::maxLines
+    int lines = 4;
+
+    // whether it has to work out whatever pieces come after the queue, or for some of them
+    bool guaranteed = true;
+
+    // threads to search on, 0 for one per core
+    int threads = 0;
+
+    // time to search for, in milliseconds, nothing is found if it runs out first
+    int budget = 100;
+
+    // slots in the table of positions searched
+    std::size_t tableSize = std::size_t(1) << 22;
+};
+
+struct PerfectClearStep
+{
+    Placement placement;
+
+    // hold before placing, the placement is then of the piece that comes in
+    bool hold = false;
+};
+
+struct PerfectClear
+{
+    bool found = false;
+
+    // the placements of known pieces, in order. if it takes pieces that are not known yet the
+    // steps stop before them, and the rest can be found once they are
+    std::vector<PerfectClearStep> steps;
+
+    // whether the steps clear the board by themselves
+    bool complete = false;
+
+    // the budget ran out, so there may be a clear even if none was found
+    bool stopped = false;
+
+    // positions searched
+    std::uint64_t nodes = 0;
+};
+
+class PerfectClearSolver
+{
+public:
+    static constexpr int maxLines = 10;
+
+    explicit PerfectClearSolver(PerfectClearOptions = PerfectClearOptions());
+
+    // for the active piece of a game, which must not have moved since it spawned
+    PerfectClear solve(Game&);
+
+    // for a board, the active piece, the pieces after it, the hold slot and the pieces left
+    // in the bag after those (see Game::getBagLeft). nothing is found if anything on the board
+    // is above the limit
+    PerfectClear solve(const FeatureBoard&, Piece active, const std::vector<Piece>& upcoming,
+                       std::optional<Piece> held, bool canHold, const std::vector<Piece>& bagLeft);
+
+private:
+    struct State
+    {
+        // the rows left, bit x being column x, and how many there are
+        std::array<std::uint16_t, maxLines> rows = {};
+        int height = 0;
+
+        // pieces known to be coming, the first being the one to play next
+        std::array<Piece, 16> queue = {};
+        int queued = 0;
+
+        std::optional<Piece> held;
+        bool canHold = true;
+
+        // pieces left in the bag the next unknown piece comes from, a bit per Piece
+        std::uint8_t bag = 0;
+    };
+
+    // one move: a placement, maybe after holding, and what it leads to
+    struct Move
+    {
+        PerfectClearStep step;
+        State next;
+
+        // false for holding alone, when the piece holding brings in is not known yet
+        bool placed = true;
+    };
+
+    PerfectClearOptions options;
+    ThreadPool pool;
+
+    // whether positions searched work, 1 or 0
+    TranspositionTable outcomes;
+
+    // pieces known at the root, which more come in to keep up as pieces are placed
+    int window = 0;
+
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<bool> stopped{false};
+    std::atomic<std::uint64_t> nodes{0};
+
+    // the lowest root move found to work so far, moves after it stop searching
+    std::atomic<int> solvedBy{0};
+
+    // by piece, how often drawing it settled a draw: made it fail when every piece has to
+    // work, or work when one has to
+    std::array<std::atomic<std::uint32_t>, 7> settled = {};
+
+    // every move from a position, lowest placements first
+    void moves(const State&, std::vector<Move>&);
+
+    // whether a position can be cleared, extending steps with the placements of known pieces
+    // on the way. job is the root move being searched, for giving up once an earlier one has
+    // worked, in which case the result means nothing
+    bool search(const State&, int job, bool known, std::vector<PerfectClearStep>& steps);
+
+    // count a node, false if the root move is to be given up
+    bool keepGoing(int job);
+
+    // whether to give up on a root move, because an earlier one worked or time ran out
+    bool cancelled(int job);
+
+    std::uint64_t keyOf(const State&);
+};
+
+#endif  // PERFECT_H_
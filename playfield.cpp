@@ -4,6 +4,8 @@
 
 #include <iostream>
 
+Playfield::Playfield(int startLevel) : scorer(startLevel) {}
+
 bool Playfield::squareFull(int x, int y)
 {
     return (y < HEIGHT && y >= 0 && x < WIDTH && x >= 0) ? grid.at(x).at(y) != Empty : true;
@@ -26,35 +28,10 @@ void Playfield::addTetromino(Tetromino* t)
             grid.at(coord.first).at(coord.second) = colour;
         }
     }
+    if (tracking) features.add(squares);
 }
 
-void Playfield::print(Tetromino* t)
-{
-    auto board = grid;
-    auto tetrLoc = t->getTrueLocation();
-    auto tetrCol = t->getColour();
-    for (auto coord : tetrLoc) {
-        if (coord.second < HEIGHT && coord.second >= 0)
-            board.at(coord.first).at(coord.second) = tetrCol;
-        std::cout << coord.first << " " << coord.second << std::endl;
-    }
-    std::cout << "------------" << std::endl;
-    // don't display the top 2 rows
-    for (int i = HEIGHT - 1; i >= 0; i--) {
-        std::cout << "|";
-        for (int j = 0; j < WIDTH; j++) {
-            if (board.at(j).at(i) == Empty) {
-                std::cout << " ";
-            } else {
-                std::cout << "X";
-            }
-        }
-        std::cout << "|" << std::endl;
-    }
-    std::cout << "------------" << std::endl;
-}
-
-int Playfield::handleFullLines()
+int Playfield::handleFullLines(Spin spin)
 {
     int linesCleared = 0;
     for (int y = 0; y < HEIGHT;) {
@@ -77,17 +54,45 @@ int Playfield::handleFullLines()
             y++;
         }
     }
-    if (linesCleared > 0)
-        combo++;
-    else
-        combo = 0;
-    switch (linesCleared) {
-    case 1: return 100 + 50 * combo;
-    case 2: return 300 + 50 * combo;
-    case 3: return 500 + 50 * combo;
-    case 4: return 800 + 50 * combo;
-    default: return 0;
+    // pieces always rest on something and clears remove whole rows, so the rows that are
+    // not empty are always the bottom ones, and the board is empty if the bottom row is
+    bool perfectClear = linesCleared > 0;
+    for (int x = 0; x < WIDTH; x++) {
+        if (grid.at(x).at(0) != Empty) perfectClear = false;
     }
+    if (tracking) features.clearLines();
+    lastClear = scorer.lock(linesCleared, spin, perfectClear);
+    return lastClear.points;
 }
 
+int Playfield::getLinesCleared() { return lastClear.lines; }
+
+int Playfield::getCombo() { return scorer.getCombo(); }
+
+ClearResult Playfield::getLastClear() { return lastClear; }
+
+int Playfield::getLevel() { return scorer.getLevel(); }
+
 std::array<std::array<Square, HEIGHT>, WIDTH> Playfield::getGrid() { return grid; }
+
+void Playfield::trackFeatures(bool on)
+{
+    if (on && !tracking) features.reset(grid);
+    tracking = on;
+}
+
+BoardFeatures Playfield::getFeatures()
+{
+    if (tracking) return features.getFeatures();
+    FeatureBoard board;
+    board.reset(grid);
+    return board.getFeatures();
+}
+
+BoardFeatures Playfield::featuresAfter(const std::array<std::pair<int, int>, 4>& squares)
+{
+    if (tracking) return features.after(squares);
+    FeatureBoard board;
+    board.reset(grid);
+    return board.after(squares);
+}
@@ -3,6 +3,8 @@
 
 #include "dimensions.hpp"
 #include "enums.hpp"
+#include "features.hpp"
+#include "scoring.hpp"
 
 #include <array>
 
@@ -11,6 +13,8 @@ class Tetromino;
 class Playfield
 {
 public:
+    Playfield(int startLevel = 1);
+
     // given an x and a y, with 0 <= x < width and 0 <= y < height, return if there is
     // already a square in that position
     bool squareFull(int, int);
@@ -21,15 +25,36 @@ public:
     // given 4 positions, add blocks in these positions with the specified square type/colour
     void addTetromino(Tetromino*);
 
-    // pretty print to stdout, including tetromino (active piece)
-    void print(Tetromino*);
+    // check for full lines and clear them, returning the score gained. the spin is that of
+    // the piece just added, see spinFromCorners
+    int handleFullLines(Spin spin = NoSpin);
+
+    // number of lines cleared by the last handleFullLines
+    int getLinesCleared();
+
+    // number of consecutive clears so far
+    int getCombo();
 
-    // check for full lines and clear them, returning the score gained
-    int handleFullLines();
+    // everything about the last handleFullLines: spin, back-to-back, perfect clear, garbage
+    ClearResult getLastClear();
+
+    int getLevel();
 
     // get the grid
     std::array<std::array<Square, HEIGHT>, WIDTH> getGrid();
 
+    // keep board features up to date on every lock, for bots and evaluators. off by default,
+    // since playing does not need them
+    void trackFeatures(bool);
+
+    // features of the board as it is. measured from the grid if they are not tracked
+    BoardFeatures getFeatures();
+
+    // features once a piece with these squares is added and full lines are cleared, without
+    // changing the board. only looks at the columns and rows the piece touches if features
+    // are tracked
+    BoardFeatures featuresAfter(const std::array<std::pair<int, int>, 4>&);
+
 private:
     // initialise the grid with empty squares
     std::array<std::array<Square, HEIGHT>, WIDTH> grid = {Empty};
@@ -37,8 +62,13 @@ private:
     // whether the game is over, should be set when a tetromino is placed
     bool gameOver = false;
 
-    // number of consecutive clears
-    int combo = 0;
+    // level, combo and back-to-back state
+    Scorer scorer;
+
+    ClearResult lastClear;
+
+    bool tracking = false;
+    FeatureBoard features;
 };
 
 #endif  // PLAYFIELD_H_
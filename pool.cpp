@@ -0,0 +1,117 @@
+#include "pool.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// the pool and queue a worker thread belongs to
+thread_local ThreadPool* ownPool = nullptr;
+thread_local int ownQueue = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int threads)
+{
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < threads; i++)
+        queues.push_back(std::make_unique<Queue>());
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back([this, i] { work(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+int ThreadPool::size() { return queues.size(); }
+
+void ThreadPool::parallelFor(int n, const std::function<void(int)>& job)
+{
+    if (n <= 0) return;
+    if (n == 1 || queues.size() == 1) {
+        for (int i = 0; i < n; i++)
+            job(i);
+        return;
+    }
+    int queue = self();
+    std::atomic<int> pending(n);
+    {
+        // backwards, so the back of the deque, which this thread takes from, is job 1
+        Queue& own = *queues[queue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        for (int i = n - 1; i > 0; i--)
+            own.jobs.push_back({&job, i, &pending});
+    }
+    queued.fetch_add(n - 1);
+    {
+        // taking the lock orders this after a worker checking queued, so none sleeps through
+        std::lock_guard<std::mutex> lock(sleep);
+    }
+    wake.notify_all();
+
+    run({&job, 0, &pending});
+    while (pending.load(std::memory_order_acquire) > 0) {
+        Job next;
+        if (take(queue, next))
+            run(next);
+        else
+            std::this_thread::yield();
+    }
+}
+
+int ThreadPool::self() { return ownPool == this ? ownQueue : 0; }
+
+bool ThreadPool::take(int queue, Job& job)
+{
+    {
+        Queue& own = *queues[queue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    int count = queues.size();
+    for (int i = 1; i < count; i++) {
+        Queue& other = *queues[(queue + i) % count];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.jobs.empty()) {
+            job = other.jobs.front();
+            other.jobs.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(const Job& job)
+{
+    (*job.body)(job.index);
+    job.pending->fetch_sub(1, std::memory_order_release);
+}
+
+void ThreadPool::work(int queue)
+{
+    ownPool = this;
+    ownQueue = queue;
+    for (;;) {
+        Job job;
+        if (take(queue, job)) {
+            run(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep);
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fork-join thread pool where idle threads steal work, for searches that split unevenly
+//
+// every thread has its own deque of jobs. a thread adds the jobs it forks to the back of its
+// own deque and takes its next job from the back too, so it keeps working depth first on what
+// it split last, while a thread that runs out takes from the front of someone else's deque,
+// which is the oldest and usually the biggest piece of work. a thread waiting for its jobs to
+// finish runs jobs in the meantime instead of blocking, so jobs can fork jobs of their own
+
+class ThreadPool
+{
+public:
+    // threads to run jobs on, counting the one that calls parallelFor, 0 for one per core
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size();
+
+    // job(i) for every i from 0 to n - 1, spread over the pool, returning once all are done.
+    // job 0 runs on the calling thread straight away, the rest are left to be stolen and are
+    // taken up by the caller in order of i when nobody does. can be called from within a job
+    void parallelFor(int n, const std::function<void(int)>& job);
+
+private:
+    struct Job
+    {
+        const std::function<void(int)>* body;
+        int index;
+        std::atomic<int>* pending;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // one per thread, the first belongs to whichever threads outside the pool call in
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    // jobs in any queue, for workers going to sleep
+    std::atomic<int> queued{0};
+    std::mutex sleep;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    // the queue of the calling thread
+    int self();
+
+    // the newest job of a queue, or the oldest of another one
+    bool take(int queue, Job&);
+
+    void run(const Job&);
+    void work(int queue);
+};
+
+#endif  // POOL_H_
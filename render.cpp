@@ -0,0 +1,136 @@
+#include "eventlog.hpp"
+#include "game.hpp"
+#include "software.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+// headless renderer, plays a seeded game with random inputs and writes every frame out
+//
+//   tetris-render -f y4m > game.y4m
+//   tetris-render -f raw -W 1280 -H 720 | ffmpeg -f rawvideo -pix_fmt rgb24 -s 1280x720 ...
+//   tetris-render -f ppm -o frames        (frames/000000.ppm, ...)
+//   tetris-render -e events.log ...       (also record the game, see eventlog.hpp)
+
+void usage(const char*);
+
+void playRandomInput(Game&, std::mt19937&);
+
+int main(int argc, char* argv[])
+{
+    int width = 1920;
+    int height = 1080;
+    int fps = 60;
+    int frames = 600;
+    unsigned int seed = 0;
+    std::string format = "y4m";
+    std::string directory = ".";
+    std::string eventPath;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "W:H:r:n:s:f:o:e:")) != -1) {
+        switch (opt) {
+        case 'W': width = std::atoi(optarg); break;
+        case 'H': height = std::atoi(optarg); break;
+        case 'r': fps = std::atoi(optarg); break;
+        case 'n': frames = std::atoi(optarg); break;
+        case 's': seed = std::strtoul(optarg, NULL, 10); break;
+        case 'f': format = optarg; break;
+        case 'o': directory = optarg; break;
+        case 'e': eventPath = optarg; break;
+        default: usage(argv[0]); return -1;
+        }
+    }
+    if (width <= 0 || height <= 0 || fps <= 0 || frames < 0
+        || (format != "y4m" && format != "ppm" && format != "raw")) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    SoftwareRenderer renderer(
+      width, height, format == "y4m" ? SoftwareRenderer::YUV444 : SoftwareRenderer::RGB);
+    Game game(seed);
+    std::mt19937 input(seed);
+
+    std::unique_ptr<EventLog> log;
+    std::unique_ptr<EventLog::Writer> events;
+    if (!eventPath.empty()) {
+        log = std::make_unique<EventLog>(eventPath);
+        if (!log->isOpen()) return -1;
+        events = std::make_unique<EventLog::Writer>(*log);
+        game.setEventWriter(events.get(), log->newGame());
+    }
+
+    // a full buffer per write keeps the number of syscalls per frame small
+    static char outBuffer[1 << 20];
+    std::setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+    if (format == "y4m") renderer.writeY4MHeader(stdout, fps);
+
+    // gravity every 300ms of video, like the interactive frontends
+    int gravityFrames = std::max(1, fps * 300 / 1000);
+    auto start = std::chrono::steady_clock::now();
+    int frame;
+    for (frame = 0; frame < frames && !game.isGameOver(); frame++) {
+        playRandomInput(game, input);
+        if (frame % gravityFrames == gravityFrames - 1) game.gravity();
+
+        renderer.draw(game);
+        bool ok;
+        if (format == "ppm") {
+            char name[32];
+            std::snprintf(name, sizeof(name), "/%06d.ppm", frame);
+            std::FILE* f = std::fopen((directory + name).c_str(), "wb");
+            ok = f && renderer.writePPM(f);
+            if (f) std::fclose(f);
+        } else if (format == "y4m") {
+            ok = renderer.writeY4MFrame(stdout);
+        } else {
+            ok = renderer.writeRaw(stdout);
+        }
+        if (!ok) {
+            std::cerr << "failed to write frame " << frame << std::endl;
+            return -1;
+        }
+    }
+    std::fflush(stdout);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << frame << " frames at " << width << "x" << height << " in " << elapsed.count()
+              << "s (" << frame / elapsed.count() << " fps), score " << game.getScore()
+              << std::endl;
+    return 0;
+}
+
+void usage(const char* name)
+{
+    std::cerr << "usage: " << name
+              << " [-W width] [-H height] [-r fps] [-n frames] [-s seed] [-f y4m|ppm|raw]"
+                 " [-o directory] [-e events.log]"
+              << std::endl;
+}
+
+// roughly one input every few frames, biased towards moving rather than dropping
+void playRandomInput(Game& game, std::mt19937& input)
+{
+    switch (std::uniform_int_distribution<int>(0, 15)(input)) {
+    case 0: game.moveHorizontal(-1); break;
+    case 1: game.moveHorizontal(1); break;
+    case 2: game.rotate(Clockwise); break;
+    case 3: game.rotate(CounterClockwise); break;
+    case 4: game.softdrop(); break;
+    case 5:
+        if (std::uniform_int_distribution<int>(0, 7)(input) == 0) game.harddrop();
+        break;
+    case 6:
+        if (std::uniform_int_distribution<int>(0, 15)(input) == 0) game.hold();
+        break;
+    }
+}
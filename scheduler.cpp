@@ -0,0 +1,129 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+Task Task::promise_type::get_return_object()
+{
+    return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+Task::Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+Task::Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+Task& Task::operator=(Task&& other) noexcept
+{
+    if (this != &other) {
+        Task old(std::move(*this));
+        handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+}
+
+Task::~Task()
+{
+    if (!handle) return;
+    promise_type& promise = handle.promise();
+    if (promise.timer >= 0) promise.scheduler->release(promise.timer);
+    handle.destroy();
+}
+
+void Task::wakeAt(std::uint64_t tick)
+{
+    if (isDone()) return;
+    promise_type& promise = handle.promise();
+    if (promise.timer < 0) return;
+    Scheduler::Timer& timer = promise.scheduler->timers[promise.timer];
+    if (timer.armed) promise.scheduler->arm(promise.timer, tick, timer.order, handle);
+}
+
+bool Task::isDone() { return !handle || handle.done(); }
+
+bool Scheduler::Awaiter::await_ready() { return tick <= scheduler->tick; }
+
+void Scheduler::Awaiter::await_suspend(std::coroutine_handle<Task::promise_type> h)
+{
+    Task::promise_type& promise = h.promise();
+    if (promise.timer < 0) {
+        promise.scheduler = scheduler;
+        promise.timer = scheduler->acquire();
+    }
+    scheduler->arm(promise.timer, tick, order, h);
+}
+
+bool Scheduler::Entry::operator<(const Entry& other) const
+{
+    return std::tie(other.tick, other.order, other.sequence) < std::tie(tick, order, sequence);
+}
+
+std::uint64_t Scheduler::now() { return tick; }
+
+bool Scheduler::inTick() { return running; }
+
+Scheduler::Awaiter Scheduler::at(std::uint64_t t, int order) { return {this, t, order}; }
+
+Scheduler::Awaiter Scheduler::after(std::uint64_t ticks, int order)
+{
+    return {this, tick + ticks, order};
+}
+
+void Scheduler::advance()
+{
+    tick++;
+    running = true;
+    while (!heap.empty() && heap.top().tick <= tick) {
+        Entry entry = heap.top();
+        heap.pop();
+        Timer& timer = timers[entry.timer];
+        // moved or cancelled since
+        if (!timer.armed || timer.generation != entry.generation) continue;
+        timer.armed = false;
+        armed--;
+        // resuming may add timers and move the vector, so nothing refers into it afterwards
+        timer.handle.resume();
+    }
+    running = false;
+}
+
+std::size_t Scheduler::waiting() { return armed; }
+
+int Scheduler::acquire()
+{
+    if (freeTimers.empty()) {
+        timers.emplace_back();
+        return timers.size() - 1;
+    }
+    int timer = freeTimers.back();
+    freeTimers.pop_back();
+    return timer;
+}
+
+void Scheduler::release(int timer)
+{
+    disarm(timer);
+    freeTimers.push_back(timer);
+}
+
+void Scheduler::arm(int timer, std::uint64_t t, int order, std::coroutine_handle<> handle)
+{
+    Timer& entry = timers[timer];
+    if (!entry.armed) armed++;
+    entry.handle = handle;
+    entry.generation++;
+    entry.order = order;
+    entry.armed = true;
+    // nothing can wait for a tick that has been run, it would never come up
+    t = std::max(t, running ? tick : tick + 1);
+    heap.push({t, order, sequence++, timer, entry.generation});
+}
+
+void Scheduler::disarm(int timer)
+{
+    Timer& entry = timers[timer];
+    if (!entry.armed) return;
+    armed--;
+    entry.armed = false;
+    entry.generation++;
+}
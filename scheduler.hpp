@@ -0,0 +1,133 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <queue>
+#include <vector>
+
+// game timing as coroutines waiting on ticks
+//
+// a Scheduler keeps a heap of the ticks its coroutines wait for, so running a tick only
+// resumes the ones that are due, however many games share it, and a game that is only
+// waiting costs nothing until then. a coroutine waits with co_await scheduler.at(tick) or
+// scheduler.after(ticks), and the tick it wakes at can be moved from outside with
+// Task::wakeAt, which is how a lock delay restarts. moved and cancelled waits are not taken
+// out of the heap, every wait has a generation and entries of an old one are skipped when
+// they come up
+
+class Scheduler;
+
+// a coroutine run by a Scheduler. it starts straight away and runs up to its first co_await.
+// destroying the Task destroys the coroutine and cancels what it was waiting for
+class Task
+{
+public:
+    struct promise_type
+    {
+        Scheduler* scheduler = nullptr;
+
+        // the scheduler's timer for this coroutine, from its first wait on
+        int timer = -1;
+
+        Task get_return_object();
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    Task() = default;
+    Task(Task&&) noexcept;
+    Task& operator=(Task&&) noexcept;
+    ~Task();
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    // resume the coroutine at this tick instead, if it is waiting on its scheduler
+    void wakeAt(std::uint64_t tick);
+
+    // whether the coroutine has returned, or there is none
+    bool isDone();
+
+private:
+    explicit Task(std::coroutine_handle<promise_type>);
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+class Scheduler
+{
+public:
+    struct Awaiter
+    {
+        Scheduler* scheduler;
+        std::uint64_t tick;
+        int order;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<Task::promise_type>);
+        void await_resume() {}
+    };
+
+    // the tick being run, or the last one run between ticks
+    std::uint64_t now();
+
+    // whether a tick is being run
+    bool inTick();
+
+    // wait until a tick, or for a number of ticks. a tick that has already come does not wait
+    // at all. coroutines due at the same tick run by order, lowest first, then in the order
+    // they started waiting
+    Awaiter at(std::uint64_t tick, int order = 0);
+    Awaiter after(std::uint64_t ticks, int order = 0);
+
+    // run the next tick, resuming every coroutine due at it
+    void advance();
+
+    // coroutines waiting for a tick
+    std::size_t waiting();
+
+private:
+    friend class Task;
+
+    struct Timer
+    {
+        std::coroutine_handle<> handle;
+        std::uint32_t generation = 0;
+        int order = 0;
+        bool armed = false;
+    };
+
+    struct Entry
+    {
+        std::uint64_t tick;
+        int order;
+        std::uint64_t sequence;
+        int timer;
+        std::uint32_t generation;
+
+        // the heap is a max heap, so the entry that sorts first is the greatest
+        bool operator<(const Entry& other) const;
+    };
+
+    std::uint64_t tick = 0;
+    bool running = false;
+    std::uint64_t sequence = 0;
+    std::size_t armed = 0;
+
+    std::priority_queue<Entry> heap;
+    std::vector<Timer> timers;
+    std::vector<int> freeTimers;
+
+    int acquire();
+    void release(int timer);
+
+    // resume handle at tick, replacing whatever the timer was set to
+    void arm(int timer, std::uint64_t tick, int order, std::coroutine_handle<>);
+    void disarm(int timer);
+};
+
+#endif  // SCHEDULER_H_
@@ -0,0 +1,118 @@
+#include "scoring.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// what a clear does to the back-to-back chain
+enum Chain { Keep, Difficult, Break };
+
+// all tables are indexed [spin][lines]. a mini can clear at most 2 lines and a T-spin at
+// most 3, the entries past that can not happen and are left at 0
+
+// points before the level multiplier
+const int basePoints[3][5] = {
+  {0, 100, 300, 500, 800},
+  {100, 200, 400, 0, 0},
+  {400, 800, 1200, 1600, 0},
+};
+
+// a tetris or any spin that clears lines is difficult, any other clear breaks the chain,
+// and a lock that clears nothing leaves it alone
+const Chain chainEffect[3][5] = {
+  {Keep, Break, Break, Break, Difficult},
+  {Keep, Difficult, Difficult, Keep, Keep},
+  {Keep, Difficult, Difficult, Difficult, Keep},
+};
+
+// [effect][chain before], whether the chain is unbroken afterwards
+const bool chainAfter[3][2] = {{false, true}, {true, true}, {false, false}};
+
+const int garbageLines[3][5] = {
+  {0, 0, 1, 2, 4},
+  {0, 0, 1, 0, 0},
+  {0, 2, 4, 6, 0},
+};
+
+// garbage for the nth consecutive clear, the last entry repeats for longer combos
+const std::array<int, 12> comboGarbage = {0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5};
+
+// [back-to-back][lines], before the level multiplier
+const int perfectClearPoints[2][5] = {{0, 800, 1200, 1800, 2000}, {0, 800, 1200, 1800, 3200}};
+
+const int perfectClearGarbage = 10;
+
+// [rotation][corner mask][last kick was the final test], built once from the rule
+struct SpinTable
+{
+    Spin spin[4][16][2];
+
+    SpinTable()
+    {
+        // the corners on the side the T points to, for each rotation identifier
+        const int front[4] = {
+          TopLeft | TopRight, TopRight | BottomRight, BottomRight | BottomLeft,
+          BottomLeft | TopLeft};
+        for (int r = 0; r < 4; r++) {
+            for (int mask = 0; mask < 16; mask++) {
+                Spin s = NoSpin;
+                if (__builtin_popcount(mask) >= 3)
+                    s = (mask & front[r]) == front[r] ? FullSpin : MiniSpin;
+                spin[r][mask][0] = s;
+                spin[r][mask][1] = s == NoSpin ? NoSpin : FullSpin;
+            }
+        }
+    }
+};
+
+const SpinTable spinTable;
+
+}  // namespace
+
+Spin spinFromCorners(int rotation, int cornerMask, int kick)
+{
+    return spinTable.spin[rotation & 3][cornerMask & 15][kick == 4];
+}
+
+Scorer::Scorer(int startLevel) : level(startLevel), startLevel(startLevel) {}
+
+ClearResult Scorer::lock(int lines, Spin spin, bool perfectClear)
+{
+    ClearResult result;
+    result.lines = lines;
+    result.spin = spin;
+    result.perfectClear = perfectClear;
+
+    Chain effect = chainEffect[spin][lines];
+    result.backToBack = backToBack & (effect == Difficult);
+    backToBack = chainAfter[effect][backToBack];
+
+    combo = (combo + 1) * (lines > 0);
+    result.combo = combo;
+    int chained = std::max(combo - 1, 0);
+
+    int points = basePoints[spin][lines];
+    points += points / 2 * result.backToBack;
+    points += 50 * chained;
+    points += perfectClearPoints[result.backToBack][lines] * perfectClear;
+    result.points = points * level;
+    result.level = level;
+
+    result.garbage = garbageLines[spin][lines] + result.backToBack
+                     + comboGarbage[std::min<int>(chained, comboGarbage.size() - 1)]
+                     + perfectClearGarbage * perfectClear;
+
+    // the level the lines were cleared at scores them, the new level applies from the next
+    this->lines += lines;
+    level = std::min(startLevel + this->lines / linesPerLevel, maxLevel);
+    return result;
+}
+
+int Scorer::getLevel() { return level; }
+
+int Scorer::getLines() { return lines; }
+
+int Scorer::getCombo() { return combo; }
+
+bool Scorer::isBackToBack() { return backToBack; }
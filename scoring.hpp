@@ -0,0 +1,77 @@
+#ifndef SCORING_H_
+#define SCORING_H_
+
+// guideline scoring, shared by every engine
+//
+// each lock is described by the number of lines it cleared, whether it was a T-spin and
+// whether it left the board empty. everything else (back-to-back, combo, level, garbage
+// sent in versus) follows from the scorer's state, and is looked up in tables indexed by
+// those few values instead of being worked out through a chain of conditions, since it
+// runs on every lock of every simulated game
+
+enum Spin { NoSpin, MiniSpin, FullSpin };
+
+// the diagonal squares around the centre of a T, as bits of a corner mask
+enum Corner {
+    TopLeft = 1,  // (-1, 1)
+    TopRight = 2,  // (1, 1)
+    BottomRight = 4,  // (1, -1)
+    BottomLeft = 8  // (-1, -1)
+};
+
+// the 3-corner rule: a T that rotated into place is a T-spin if at least 3 of the corners
+// around its centre are full (walls and floor count), a full T-spin if both corners on the
+// side it points to are full, otherwise a mini. the last SRS kick test upgrades a mini to
+// a full T-spin. callers must only ask for T pieces whose last move was a rotation
+Spin spinFromCorners(int rotation, int cornerMask, int kick);
+
+struct ClearResult
+{
+    int lines = 0;
+    Spin spin = NoSpin;
+    bool perfectClear = false;
+
+    // whether this clear got the back-to-back bonus
+    bool backToBack = false;
+
+    // consecutive locks that cleared lines, including this one, 0 if it cleared nothing
+    int combo = 0;
+
+    // points, including the level multiplier, and the level they were scored at
+    int points = 0;
+    int level = 0;
+
+    // lines of garbage this clear sends to an opponent
+    int garbage = 0;
+};
+
+class Scorer
+{
+public:
+    Scorer(int startLevel = 1);
+
+    // score a lock and advance the back-to-back chain, combo, line count and level
+    ClearResult lock(int lines, Spin, bool perfectClear);
+
+    int getLevel();
+    int getLines();
+
+    // consecutive locks that cleared lines, 0 after a lock that cleared nothing
+    int getCombo();
+
+    // whether the last difficult clear (tetris or T-spin with lines) is still unbroken
+    bool isBackToBack();
+
+    // lines needed per level
+    static constexpr int linesPerLevel = 10;
+    static constexpr int maxLevel = 20;
+
+private:
+    int level;
+    int startLevel;
+    int lines = 0;
+    int combo = 0;
+    bool backToBack = false;
+};
+
+#endif  // SCORING_H_
@@ -0,0 +1,266 @@
+#include "search.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr float toppedOutValue = -1e9f;
+
+// nodes nearer the root than this split their children into jobs, deeper ones are searched
+// on the thread that got there
+constexpr int parallelPlies = 2;
+
+// a float as an unsigned int that sorts the same way
+std::uint32_t orderable(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+// keep the best value and child index published so far, ties going to the lower index
+void publish(std::atomic<std::uint64_t>& best, float value, int index)
+{
+    std::uint64_t packed = std::uint64_t(orderable(value)) << 32 | (0xffffffffu - index);
+    std::uint64_t seen = best.load(std::memory_order_relaxed);
+    while (seen < packed && !best.compare_exchange_weak(seen, packed))
+        ;
+}
+
+std::uint64_t mix(std::uint64_t hash, std::uint64_t value)
+{
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+}  // namespace
+
+float boardValue(const Weights& w, const BoardFeatures& f)
+{
+    if (f.toppedOut) return toppedOutValue;
+    return w[AggregateHeightWeight] * f.aggregateHeight + w[MaxHeightWeight] * f.maxHeight
+           + w[HolesWeight] * f.holes + w[RowTransitionsWeight] * f.rowTransitions
+           + w[ColumnTransitionsWeight] * f.columnTransitions + w[WellsWeight] * f.wells
+           + w[BumpinessWeight] * f.bumpiness;
+}
+
+float clearValue(const Weights& w, const BoardFeatures& f, Spin spin)
+{
+    if (f.linesCleared == 0) return 0;
+    float value = w[Clear1Weight + std::min(f.linesCleared, 4) - 1];
+    if (spin != NoSpin) value += w[TSpinWeight] * f.linesCleared;
+    return value;
+}
+
+float evaluate(const Weights& weights, const BoardFeatures& features, Spin spin)
+{
+    return clearValue(weights, features, spin) + boardValue(weights, features);
+}
+
+Bot::Bot(BotOptions o) : options(o), pool(o.threads), table(o.tableSize) {}
+
+Decision Bot::think(Game& game)
+{
+    if (game.isGameOver()) return Decision();
+    FeatureBoard board;
+    board.reset(game.getPlayfield().getGrid());
+    std::vector<Piece> upcoming;
+    for (const auto& piece : game.getUpcoming())
+        upcoming.push_back(piece->getPiece());
+    std::optional<Piece> held;
+    if (game.getCarryPiece()) held = game.getCarryPiece()->getPiece();
+    return think(board, game.getActivePiece().getPiece(), upcoming, held, game.canHold());
+}
+
+Decision Bot::think(const FeatureBoard& board, Piece active, const std::vector<Piece>& upcoming,
+                    std::optional<Piece> held, bool canHold)
+{
+    sequence.assign(1, active);
+    sequence.insert(sequence.end(), upcoming.begin(), upcoming.end());
+    auto start = std::chrono::steady_clock::now();
+    stopped = false;
+    nodes = 0;
+
+    // the root is expanded whatever the time, there is no decision without its children, but
+    // it counts against the budget
+    Node root{board, 0, held, canHold};
+    std::vector<Child> children;
+    deadline = std::chrono::steady_clock::time_point::max();
+    expand(root, children);
+    deadline = start + std::chrono::milliseconds(options.budget);
+    Decision decision;
+    if (children.empty()) return decision;
+    int count = children.size();
+
+    // a ply looks at every placement of the active piece, its static value is the first ply
+    auto choose = [&](int index, float value, int depth) {
+        decision.placement = children[index].placement;
+        decision.hold = children[index].hold;
+        decision.value = value;
+        decision.depth = depth;
+        decision.found = true;
+    };
+    int best = 0;
+    choose(best, children[0].value, 1);
+
+    int limit = std::min<int>(options.maxDepth, sequence.size());
+    for (int depth = 2; depth <= limit; depth++) {
+        std::vector<char> done(count, 0);
+        std::atomic<std::uint64_t> published{0};
+        pool.parallelFor(count, [&](int i) {
+            const Child& child = children[i];
+            float value = child.value;
+            if (!child.features.toppedOut) {
+                if (!search(childNode(root, child), depth - 1, 1, value)) return;
+                value += child.reward;
+            }
+            done[i] = 1;
+            publish(published, value, i);
+        });
+        std::uint64_t packed = published.load();
+        bool complete = std::count(done.begin(), done.end(), 1) == count;
+        // a ply cut short is only better informed if it got as far as the last ply's choice,
+        // otherwise it may just not have reached anything better
+        if (packed != 0 && (complete || done[best])) {
+            best = 0xffffffffu - std::uint32_t(packed);
+            std::uint32_t bits = packed >> 32;
+            bits = bits & 0x80000000u ? bits & 0x7fffffffu : ~bits;
+            float value;
+            std::memcpy(&value, &bits, sizeof value);
+            choose(best, value, complete ? depth : decision.depth);
+        }
+        if (!complete) break;
+    }
+    decision.nodes = nodes.load();
+    return decision;
+}
+
+bool Bot::expand(const Node& node, std::vector<Child>& out)
+{
+    auto start = std::chrono::steady_clock::now();
+    out.clear();
+    if (node.next >= int(sequence.size())) return true;
+    PaddedBoard padded = pad(node.board);
+    std::vector<Placement> found;
+    // the clock is checked before each movegen search, which with scoring what it finds is
+    // most of a node
+    auto add = [&](Piece piece, bool hold, int next, std::optional<Piece> held) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        placements(padded, piece, found);
+        for (const Placement& placement : found) {
+            Child child;
+            child.placement = placement;
+            child.hold = hold;
+            child.features = node.board.after(placement.cells());
+            child.reward = clearValue(options.weights, child.features, placement.spin);
+            child.value = child.reward + boardValue(options.weights, child.features);
+            child.next = next;
+            child.held = held;
+            out.push_back(child);
+        }
+        return true;
+    };
+    Piece current = sequence[node.next];
+    if (!add(current, false, node.next + 1, node.held)) return false;
+    if (node.canHold) {
+        if (node.held) {
+            if (*node.held != current && !add(*node.held, true, node.next + 1, current))
+                return false;
+        } else if (node.next + 1 < int(sequence.size())) {
+            // nothing held yet, the next piece comes into play
+            if (!add(sequence[node.next + 1], true, node.next + 2, current)) return false;
+        }
+    }
+    std::stable_sort(out.begin(), out.end(),
+                     [](const Child& a, const Child& b) { return a.value > b.value; });
+    // an average that follows the last few dozen nodes, of every thread
+    auto took = std::chrono::steady_clock::now() - start;
+    std::int64_t average = expansion.load(std::memory_order_relaxed);
+    expansion.store(average + (took.count() - average) / 16, std::memory_order_relaxed);
+    return true;
+}
+
+Bot::Node Bot::childNode(const Node& node, const Child& child)
+{
+    Node next{node.board, child.next, child.held, true};
+    next.board.add(child.placement.cells());
+    next.board.clearLines();
+    return next;
+}
+
+bool Bot::search(const Node& node, int depth, int ply, float& value)
+{
+    if (!keepGoing()) return false;
+    if (node.next >= int(sequence.size())) {
+        // out of pieces, the board is all there is to go on
+        value = boardValue(options.weights, node.board.getFeatures());
+        return true;
+    }
+    std::uint64_t key = keyOf(node);
+    if (table.probe(key, depth, value)) return true;
+
+    std::vector<Child> children;
+    if (!expand(node, children)) {
+        stopped = true;
+        return false;
+    }
+    if (children.empty()) {
+        value = toppedOutValue;
+        return true;
+    }
+    if (depth == 1) {
+        value = children[0].value;
+        table.store(key, depth, value);
+        return true;
+    }
+
+    int count = std::min<int>(children.size(), options.width);
+    std::vector<float> values(count);
+    std::atomic<bool> complete(true);
+    auto one = [&](int i) {
+        const Child& child = children[i];
+        values[i] = child.value;
+        if (child.features.toppedOut) return;
+        float below;
+        if (!search(childNode(node, child), depth - 1, ply + 1, below))
+            complete = false;
+        else
+            values[i] = child.reward + below;
+    };
+    if (ply < parallelPlies) {
+        pool.parallelFor(count, one);
+    } else {
+        for (int i = 0; i < count && complete; i++)
+            one(i);
+    }
+    if (!complete) return false;
+    value = *std::max_element(values.begin(), values.end());
+    table.store(key, depth, value);
+    return true;
+}
+
+bool Bot::keepGoing()
+{
+    if (stopped.load(std::memory_order_relaxed)) return false;
+    // every node, a node is a whole movegen search and the clock is nothing next to it. no
+    // node starts without the time an average one takes
+    nodes.fetch_add(1, std::memory_order_relaxed);
+    std::chrono::steady_clock::duration average(expansion.load(std::memory_order_relaxed));
+    if (std::chrono::steady_clock::now() + average >= deadline) {
+        stopped = true;
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t Bot::keyOf(const Node& node)
+{
+    std::uint64_t hash = sequence.size() - node.next;
+    for (std::uint32_t row : node.board.getRows())
+        hash = mix(hash, row);
+    for (std::size_t i = node.next; i < sequence.size(); i++)
+        hash = mix(hash, sequence[i] + 1);
+    hash = mix(hash, node.held ? *node.held + 1 : 0);
+    return mix(hash, node.canHold);
+}
@@ -0,0 +1,173 @@
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include "enums.hpp"
+#include "features.hpp"
+#include "game.hpp"
+#include "movegen.hpp"
+#include "pool.hpp"
+#include "scoring.hpp"
+#include "transposition.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// a bot that looks ahead through the preview queue, on every core
+//
+// the search works on FeatureBoards and the bitboards of movegen.hpp instead of Games, which
+// can not be copied since their pieces point at their playfield. a node is a board, the
+// pieces still to come and the hold slot, its children are every placement of the next piece,
+// with or without holding first, and its value is the best of its children's: the reward for
+// the lines a placement clears plus the value of what follows, down to the static evaluation
+// of the board at the leaves. below the root only the most promising children by static
+// evaluation are searched, the rest are cut
+//
+// the root's children and theirs are split into jobs for a ThreadPool, deeper levels run on
+// the thread that took the job. positions reached in different orders are looked up in a
+// TranspositionTable shared by every thread. search deepens one ply at a time until the
+// queue runs out or the time does, and the first thread to see the clock run out sets a flag
+// that stops every other one. the best root move of a ply is published with an atomic max
+// as each one finishes, so a ply cut short still gives the best of the moves it finished.
+// that is the only value threads share: with no opponent every node takes the best of its
+// children, so a bound found in one subtree can never cut another one
+
+enum Weight {
+    AggregateHeightWeight,
+    MaxHeightWeight,
+    HolesWeight,
+    RowTransitionsWeight,
+    ColumnTransitionsWeight,
+    WellsWeight,
+    BumpinessWeight,
+    Clear1Weight,
+    Clear2Weight,
+    Clear3Weight,
+    Clear4Weight,
+    // per line cleared with a T-spin, on top of the clear
+    TSpinWeight,
+    WeightCount
+};
+
+typedef std::array<float, WeightCount> Weights;
+
+constexpr Weights defaultWeights = {-0.3f, -0.5f, -8.0f, -3.0f, -9.0f, -3.4f, -0.5f,
+                                    3.0f,  7.0f,  11.0f, 20.0f, 6.0f};
+
+// value of a board, much lower than any other value for a board that is topped out
+float boardValue(const Weights&, const BoardFeatures&);
+
+// reward for the lines a placement cleared
+float clearValue(const Weights&, const BoardFeatures&, Spin);
+
+// both, for a placement
+float evaluate(const Weights&, const BoardFeatures&, Spin);
+
+struct BotOptions
+{
+    // threads to search on, 0 for one per core
+    int threads = 0;
+
+    // time to think about each piece, in milliseconds
+    int budget = 100;
+
+    // pieces to look ahead, counting the active one. the queue and hold slot limit it too
+    int maxDepth = 6;
+
+    // children searched below the root
+    int width = 8;
+
+    Weights weights = defaultWeights;
+
+    // slots in the transposition table
+    std::size_t tableSize = std::size_t(1) << 20;
+};
+
+struct Decision
+{
+    // where to put the active piece, or the piece that comes into play by holding it
+    Placement placement;
+    bool hold = false;
+
+    float value = 0;
+
+    // plies searched in full, and nodes searched altogether
+    int depth = 0;
+    std::uint64_t nodes = 0;
+
+    // false if no piece can be placed at all
+    bool found = false;
+};
+
+class Bot
+{
+public:
+    explicit Bot(BotOptions = BotOptions());
+
+    // for the active piece of a game, which must not have moved since it spawned
+    Decision think(Game&);
+
+    // for a board, the active piece, the pieces after it and the hold slot
+    Decision think(const FeatureBoard&, Piece active, const std::vector<Piece>& upcoming,
+                   std::optional<Piece> held, bool canHold);
+
+private:
+    struct Node
+    {
+        FeatureBoard board;
+
+        // index of the next piece to place in the sequence
+        int next = 0;
+        std::optional<Piece> held;
+        bool canHold = true;
+    };
+
+    struct Child
+    {
+        Placement placement;
+        bool hold = false;
+
+        // lines cleared for the reward, and the reward plus the static value of the board
+        BoardFeatures features;
+        float reward = 0;
+        float value = 0;
+
+        // what is left to place after it
+        int next = 0;
+        std::optional<Piece> held;
+    };
+
+    BotOptions options;
+    ThreadPool pool;
+    TranspositionTable table;
+
+    // the active piece and the queue after it, for the search under way
+    std::vector<Piece> sequence;
+
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<bool> stopped{false};
+    std::atomic<std::uint64_t> nodes{0};
+
+    // how long expanding a node takes, a running average over decisions, in clock ticks
+    std::atomic<std::int64_t> expansion{0};
+
+    // every child of a node, by static value, best first. false if time ran out first
+    bool expand(const Node&, std::vector<Child>&);
+
+    // the board and pieces left after a child
+    Node childNode(const Node&, const Child&);
+
+    // value of a node searched to a depth, false if the search was stopped before it was
+    // done. ply is the depth of the node itself, the root being 0
+    bool search(const Node&, int depth, int ply, float& value);
+
+    // count a node, stopping the search when there is no time for it
+    bool keepGoing();
+
+    std::uint64_t keyOf(const Node&);
+};
+
+#endif  // SEARCH_H_
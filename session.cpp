@@ -0,0 +1,157 @@
+#include "session.hpp"
+
+#include "timing.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// within a tick, inputs come before gravity and the lock delay, as in a frontend that reads
+// its keys and then ticks the game
+enum Order { InputOrder, GameOrder };
+
+}  // namespace
+
+Session::Session(Scheduler& s, unsigned int seed, int startLevel, SessionTiming t)
+  : scheduler(s), game(seed, DelayLock, startLevel), timing(t)
+{
+    start(scheduler.now());
+    play = run();
+}
+
+void Session::apply(Action a)
+{
+    if (!live || game.isGameOver()) return;
+    std::uint64_t tick = inputTick();
+    settle(tick);
+    game.apply(a);
+    if (game.isGameOver()) return;
+    if (&game.getActivePiece() != piece) {
+        // held, or locked by a harddrop
+        if (a == ActionHold)
+            start(tick);
+        else
+            locked(tick);
+    }
+    play.wakeAt(nextWake());
+}
+
+void Session::press(Action a) { repeats[a] = autoRepeat(a); }
+
+void Session::release(Action a) { repeats[a] = Task(); }
+
+Game& Session::getGame() { return game; }
+
+bool Session::isLive() { return live; }
+
+int Session::getLockTicks()
+{
+    int ticks = piece->getLockTicks();
+    std::uint64_t tick = inputTick();
+    if (live && tick > restedThrough && piece->dropDistance() == 0) ticks += tick - restedThrough;
+    return ticks;
+}
+
+Task Session::run()
+{
+    while (!game.isGameOver()) {
+        co_await scheduler.at(nextWake(), GameOrder);
+        if (game.isGameOver()) break;
+        std::uint64_t tick = scheduler.now();
+        if (!live) {
+            start(tick);
+            continue;
+        }
+        // the same as Tetromino::tick, for this one tick
+        settle(tick - 1);
+        piece->fall(cellsAt(tick));
+        if (piece->dropDistance() == 0) {
+            piece->rest(1);
+            if (piece->getLockTicks() >= lockDelayTicks
+                || piece->getLockResets() >= maxLockResets) {
+                game.lock();
+                if (!game.isGameOver()) locked(tick);
+                continue;
+            }
+        }
+        restedThrough = tick;
+    }
+}
+
+Task Session::autoRepeat(Action a)
+{
+    apply(a);
+    Repeat repeat = timing.repeat[a];
+    if (repeat.delay == 0) co_return;
+    co_await scheduler.after(repeat.delay, InputOrder);
+    for (;;) {
+        if (repeat.interval > 0) {
+            apply(a);
+        } else {
+            for (int i = 0; i < WIDTH + HEIGHT; i++) {
+                auto before = game.getActivePiece().getTrueLocation();
+                apply(a);
+                if (game.getActivePiece().getTrueLocation() == before) break;
+            }
+        }
+        co_await scheduler.after(std::max(repeat.interval, 1), InputOrder);
+    }
+}
+
+std::uint64_t Session::inputTick()
+{
+    return scheduler.inTick() ? scheduler.now() - 1 : scheduler.now();
+}
+
+void Session::settle(std::uint64_t tick)
+{
+    if (tick <= restedThrough) return;
+    // nothing has moved the piece since restedThrough, so it was resting at every tick since
+    // or at none
+    if (piece->dropDistance() == 0) piece->rest(tick - restedThrough);
+    restedThrough = tick;
+}
+
+int Session::cellsAt(std::uint64_t tick)
+{
+    if (gravity >= twentyG) return 2 * HEIGHT;
+    // carried only ever loses whole cells, so what is left is the total mod one cell
+    std::uint64_t before = carried + (tick - 1 - carriedAt) * std::uint64_t(gravity);
+    return ((before & (gravityOne - 1)) + gravity) >> 16;
+}
+
+std::uint64_t Session::nextWake()
+{
+    if (!live) return liveAt;
+    std::uint64_t from = restedThrough;
+    if (piece->dropDistance() > 0) {
+        if (gravity >= gravityOne) return from + 1;
+        std::uint64_t left = carried + (from - carriedAt) * std::uint64_t(gravity);
+        int fraction = left & (gravityOne - 1);
+        return from + (gravityOne - fraction + gravity - 1) / gravity;
+    }
+    if (piece->getLockResets() >= maxLockResets) return from + 1;
+    return from + std::max(1, lockDelayTicks - piece->getLockTicks());
+}
+
+void Session::start(std::uint64_t tick)
+{
+    piece = &game.getActivePiece();
+    live = true;
+    gravity = gravityAt(game.getPlayfield().getLevel());
+    carried = 0;
+    carriedAt = tick;
+    restedThrough = tick;
+}
+
+void Session::locked(std::uint64_t tick)
+{
+    int delay = timing.entryDelay;
+    if (game.getPlayfield().getLinesCleared() > 0) delay += timing.lineClearDelay;
+    if (delay == 0) {
+        start(tick);
+        return;
+    }
+    live = false;
+    liveAt = tick + delay;
+}
@@ -0,0 +1,119 @@
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include "enums.hpp"
+#include "game.hpp"
+#include "scheduler.hpp"
+
+#include <array>
+#include <cstdint>
+
+// a DelayLock game kept in time by a Scheduler, instead of by calling Game::tick every tick
+//
+// gravity, the lock delay, auto repeat of held inputs and the entry and line clear delays are
+// coroutines that sleep until the tick they next have something to do: the tick gravity has
+// moved the piece a whole cell, the tick the lock delay runs out, the next repeat of a held
+// key. ticks in between cost nothing, so a server can keep thousands of games on one
+// scheduler. with no delays a game plays out exactly as one ticked every tick, tetris-fuzz -d
+// checks that
+
+constexpr int actionCount = ActionHold + 1;
+
+// how a held input repeats, in ticks
+struct Repeat
+{
+    // before the first repeat (das), 0 for an input that does not repeat
+    int delay = 0;
+
+    // between repeats (arr), 0 to repeat as far as the piece goes on every tick
+    int interval = 0;
+};
+
+struct SessionTiming
+{
+    // ticks between a piece locking and the next one coming into play
+    int entryDelay = 0;
+
+    // ticks added to the entry delay after a lock that cleared lines
+    int lineClearDelay = 0;
+
+    // by action, nothing repeats by default
+    std::array<Repeat, actionCount> repeat = {};
+};
+
+class Session
+{
+public:
+    Session(Scheduler&, unsigned int seed, int startLevel = 1, SessionTiming = SessionTiming());
+
+    // coroutines refer to the session, so it can not be copied or moved
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // an input, between ticks or from a coroutine running before the game in a tick. ignored
+    // while no piece is in play
+    void apply(Action);
+
+    // a key going down, applied at once and then repeated as set in the timing until it is
+    // released
+    void press(Action);
+    void release(Action);
+
+    Game& getGame();
+
+    // false during the entry and line clear delays
+    bool isLive();
+
+    // ticks the active piece has rested since its lock delay last restarted, up to now. the
+    // piece itself is only told when something depends on it
+    int getLockTicks();
+
+private:
+    Scheduler& scheduler;
+    Game game;
+    SessionTiming timing;
+
+    // the active piece as of the last lock or hold, whether it is in play, and when it will be
+    // if it is not
+    Tetromino* piece = nullptr;
+    bool live = true;
+    std::uint64_t liveAt = 0;
+
+    // gravity of the piece, the fraction of a cell carried as of a tick, which gives the
+    // fraction carried at any tick after (see timing.hpp)
+    int gravity = 0;
+    int carried = 0;
+    std::uint64_t carriedAt = 0;
+
+    // last tick whose lock delay is counted in the piece
+    std::uint64_t restedThrough = 0;
+
+    Task play;
+    std::array<Task, actionCount> repeats;
+
+    // gravity, the lock delay and the delays between pieces
+    Task run();
+
+    // apply a held input and repeat it
+    Task autoRepeat(Action);
+
+    // the last tick an input sees the end of: inputs during a tick come before its gravity
+    std::uint64_t inputTick();
+
+    // count the ticks the piece has been resting up to a tick
+    void settle(std::uint64_t tick);
+
+    // cells gravity moves the piece at a tick
+    int cellsAt(std::uint64_t tick);
+
+    // next tick something can happen to the piece without an input
+    std::uint64_t nextWake();
+
+    // the active piece comes into play after a tick
+    void start(std::uint64_t tick);
+
+    // the piece locked at a tick and the next one spawned
+    void locked(std::uint64_t tick);
+};
+
+#endif  // SESSION_H_
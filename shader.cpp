@@ -0,0 +1,191 @@
+#include "shader.hpp"
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const std::size_t infoLogSize = 1024;
+
+// "TSPB", at the start of every cache file
+const std::uint32_t cacheMagic = 0x42505354;
+
+struct CacheHeader
+{
+    std::uint32_t magic;
+    std::uint32_t format;
+    std::uint32_t length;
+};
+
+// fnv-1a, only to name the cache files
+std::uint64_t hash(std::uint64_t h, const char* s)
+{
+    for (; s && *s; s++)
+        h = (h ^ std::uint8_t(*s)) * 0x100000001b3ull;
+    // separator, so that moving text from one string to the next changes the hash
+    return (h ^ 0xff) * 0x100000001b3ull;
+}
+
+const char* glString(GLenum name) { return reinterpret_cast<const char*>(glGetString(name)); }
+
+std::string cachePath(const char* vertexSource, const char* fragmentSource)
+{
+    std::string directory = shaderCacheDirectory();
+    if (directory.empty()) return "";
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    h = hash(h, glString(GL_VENDOR));
+    h = hash(h, glString(GL_RENDERER));
+    h = hash(h, glString(GL_VERSION));
+    h = hash(h, vertexSource);
+    h = hash(h, fragmentSource);
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)h);
+    return directory + name;
+}
+
+// whether the driver can hand out program binaries at all
+bool binariesSupported()
+{
+    if (!GLEW_ARB_get_program_binary) return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// the program from a cache file, 0 if there is none or the driver rejects it
+unsigned int loadBinary(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return 0;
+    std::streamoff size = file.tellg();
+    file.seekg(0);
+    CacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return 0;
+    // a damaged file is recompiled over, not trusted
+    if (header.magic != cacheMagic || header.length != size - std::streamoff(sizeof(header)))
+        return 0;
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) return 0;
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), binary.size());
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// write through a temporary file, so that instances starting at the same time never read
+// half a binary
+void saveBinary(unsigned int program, const std::string& path)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    CacheHeader header = {cacheMagic, format, std::uint32_t(length)};
+
+    std::string temporary = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) std::remove(temporary.c_str());
+}
+
+unsigned int compile(GLenum type, const char* source, const char* name)
+{
+    int success;
+    char infoLog[infoLogSize];
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, infoLogSize, NULL, infoLog);
+        std::cerr << name << " SHADER COMPILATION FAILED" << std::endl << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+}  // namespace
+
+std::string shaderCacheDirectory()
+{
+    std::string base;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        base = xdg;
+    } else if (const char* home = std::getenv("HOME"); home && *home) {
+        base = std::string(home) + "/.cache";
+        mkdir(base.c_str(), 0755);
+    } else {
+        return "";
+    }
+    std::string directory = base + "/tetris_opengl";
+    mkdir(directory.c_str(), 0755);
+    struct stat st;
+    if (stat(directory.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return "";
+    return directory;
+}
+
+unsigned int loadProgram(const char* vertexSource, const char* fragmentSource, bool* cached)
+{
+    *cached = false;
+    bool binaries = binariesSupported();
+    std::string path = binaries ? cachePath(vertexSource, fragmentSource) : "";
+    if (!path.empty()) {
+        unsigned int program = loadBinary(path);
+        if (program) {
+            *cached = true;
+            return program;
+        }
+    }
+
+    unsigned int vShader = compile(GL_VERTEX_SHADER, vertexSource, "VERTEX");
+    if (!vShader) return 0;
+    unsigned int fShader = compile(GL_FRAGMENT_SHADER, fragmentSource, "FRAGMENT");
+    if (!fShader) {
+        glDeleteShader(vShader);
+        return 0;
+    }
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vShader);
+    glAttachShader(program, fShader);
+    if (binaries) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+
+    // shaders are linked, delete to free resources
+    glDeleteShader(vShader);
+    glDeleteShader(fShader);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[infoLogSize];
+        glGetProgramInfoLog(program, infoLogSize, NULL, infoLog);
+        std::cerr << "SHADER LINKING FAILED" << std::endl << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    if (!path.empty()) saveBinary(program, path);
+    return program;
+}
@@ -0,0 +1,22 @@
+#ifndef SHADER_H_
+#define SHADER_H_
+
+#include <string>
+
+// building the shader program, with the linked binary cached on disk
+//
+// compiling and linking from source is most of the startup time of a short lived instance,
+// in particular under mesa's software renderers. once linked, the program binary is saved
+// (glGetProgramBinary) under $XDG_CACHE_HOME/tetris_opengl, or ~/.cache/tetris_opengl, in a
+// file named after a hash of the vendor, renderer and version strings and the sources, so a
+// driver update or a changed shader never picks up a stale binary. the next launch loads it
+// with glProgramBinary and only compiles again if the driver rejects it
+
+// the linked program, or 0 after printing the error log if it could not be built. cached is
+// set to whether it came from the cache. needs a current context with glew initialised
+unsigned int loadProgram(const char* vertexSource, const char* fragmentSource, bool* cached);
+
+// directory the program binaries are kept in, created if needed, empty if there is none
+std::string shaderCacheDirectory();
+
+#endif  // SHADER_H_
@@ -0,0 +1,56 @@
+#include "shapes.hpp"
+
+#include "tetrominos.hpp"
+
+#include <algorithm>
+
+namespace {
+
+PieceShape makeShape(Tetromino t)
+{
+    PieceShape s = {};
+    s.colour = t.getColour();
+    auto spawnLocation = t.getDefaultLocation();
+    auto spawnLayout = t.getLayout(0);
+    s.spawn = std::make_pair(spawnLocation[0].first - spawnLayout[0].first,
+      spawnLocation[0].second - spawnLayout[0].second);
+
+    auto kicks = t.getKicks();
+    for (int r = 0; r < 4; r++) {
+        s.layouts[r] = t.getLayout(r);
+        // kicks holds the tests for turning clockwise out of each rotation, turning counter
+        // clockwise undoes the clockwise kicks into the current rotation, as Tetromino::rotate
+        for (int k = 0; k < 5; k++) {
+            s.kicks[r][Clockwise][k] = kicks[r][k];
+            auto back = kicks[(r + 3) % 4][k];
+            s.kicks[r][CounterClockwise][k] = std::make_pair(-back.first, -back.second);
+        }
+
+        int bottom = 4, top = -4, left = 4;
+        for (auto cell : s.layouts[r]) {
+            bottom = std::min(bottom, cell.second);
+            top = std::max(top, cell.second);
+            left = std::min(left, cell.first);
+        }
+        s.bottom[r] = bottom;
+        s.top[r] = top;
+        s.left[r] = left;
+        for (auto cell : s.layouts[r])
+            s.rows[r][cell.second - bottom] |= std::uint32_t(1) << (cell.first - left);
+    }
+    return s;
+}
+
+}  // namespace
+
+const PieceShape& shapeOf(Piece p)
+{
+    static const std::array<PieceShape, 7> shapes = {makeShape(IPiece(nullptr)),
+      makeShape(JPiece(nullptr)),
+      makeShape(LPiece(nullptr)),
+      makeShape(OPiece(nullptr)),
+      makeShape(SPiece(nullptr)),
+      makeShape(TPiece(nullptr)),
+      makeShape(ZPiece(nullptr))};
+    return shapes[p];
+}
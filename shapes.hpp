@@ -0,0 +1,50 @@
+#ifndef SHAPES_H_
+#define SHAPES_H_
+
+#include "dimensions.hpp"
+#include "enums.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+// geometry of the 7 tetrominos for engines that work on bitboards instead of Tetromino
+// objects. the shapes are read from the Tetromino classes, so there is one definition of
+// the pieces and every engine agrees with it
+//
+// a bitboard row is a 32 bit mask with column x at bit x + boardPadX. bits outside the
+// board are always set, as are whole rows below the floor and above the top, so the
+// walls, floor and top count as full squares exactly like Playfield::squareFull
+
+constexpr int boardPadX = 4;
+constexpr int boardPadY = 6;
+constexpr int boardRows = HEIGHT + 2 * boardPadY;
+constexpr std::uint32_t wallRow = ~(((std::uint32_t(1) << WIDTH) - 1) << boardPadX);
+constexpr std::uint32_t fullRow = ~std::uint32_t(0);
+
+static_assert(WIDTH + 2 * boardPadX <= 32, "board rows are 32 bit masks");
+
+struct PieceShape
+{
+    Square colour;
+
+    // origin of a freshly spawned piece
+    std::pair<int, int> spawn;
+
+    // cells of each rotation relative to the origin
+    std::array<std::array<std::pair<int, int>, 4>, 4> layouts;
+
+    // offsets of the origin tried in order by a rotation, [rotation before][Rotation][test]
+    std::array<std::array<std::array<std::pair<int, int>, 5>, 2>, 4> kicks;
+
+    // each rotation as 4 rows of bits, rows[r][0] being the row at dy = bottom[r] and bit 0
+    // the column at dx = left[r]. top[r] is the highest dy
+    std::array<int, 4> bottom;
+    std::array<int, 4> top;
+    std::array<int, 4> left;
+    std::array<std::array<std::uint32_t, 4>, 4> rows;
+};
+
+const PieceShape& shapeOf(Piece);
+
+#endif  // SHAPES_H_
@@ -0,0 +1,20 @@
+#include "snapshot.hpp"
+
+void Snapshot::capture(Game& game, std::uint64_t at)
+{
+    tick = at;
+    grid = game.getGridWithActive();
+    Tetromino& piece = game.getActivePiece();
+    active = piece.getPiece();
+    rotation = piece.getRotation();
+    origin = piece.getOrigin();
+    int i = 0;
+    for (auto& p : game.getUpcoming())
+        queue[i++] = p->getPiece();
+    Tetromino* carry = game.getCarryPiece();
+    hold = carry ? carry->getPiece() : -1;
+    canHold = game.canHold();
+    score = game.getScore();
+    level = game.getPlayfield().getLevel();
+    gameOver = game.isGameOver();
+}
@@ -0,0 +1,41 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include "dimensions.hpp"
+#include "enums.hpp"
+#include "game.hpp"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+// everything a frontend needs to draw one frame of a game, copied out of it so that it can
+// be drawn on another thread while the game carries on
+
+struct Snapshot
+{
+    // simulation tick the game was copied at
+    std::uint64_t tick = 0;
+
+    // the grid with the active piece drawn in
+    std::array<std::array<Square, HEIGHT>, WIDTH> grid = {};
+
+    Piece active = I;
+    int rotation = 0;
+    std::pair<int, int> origin;
+
+    std::array<Piece, Game::previewSize> queue = {};
+
+    // -1 if nothing has been held yet
+    int hold = -1;
+    bool canHold = true;
+
+    unsigned int score = 0;
+    int level = 1;
+    bool gameOver = false;
+
+    // copy the state of a game
+    void capture(Game&, std::uint64_t tick);
+};
+
+#endif  // SNAPSHOT_H_
@@ -0,0 +1,201 @@
+#include "software.hpp"
+
+#include "game.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+// cells across and down the whole image: margin, board, gap, 5 wide panel, margin
+constexpr int layoutColumns = WIDTH + 8;
+constexpr int layoutRows = HEIGHT + 2;
+constexpr int panelColumn = WIDTH + 2;
+
+// 3x5 digits for the score, one bit per pixel, rows top to bottom
+constexpr std::array<std::array<std::uint8_t, 5>, 10> digitFont = {{
+  {7, 5, 5, 5, 7},
+  {2, 6, 2, 2, 7},
+  {7, 1, 7, 4, 7},
+  {7, 1, 7, 1, 7},
+  {5, 5, 7, 1, 1},
+  {7, 4, 7, 1, 7},
+  {7, 4, 7, 5, 7},
+  {7, 1, 1, 1, 1},
+  {7, 5, 7, 5, 7},
+  {7, 5, 7, 1, 7},
+}};
+
+}  // namespace
+
+SoftwareRenderer::SoftwareRenderer(int w, int h, Format f) : width(w), height(h), format(f)
+{
+    framebuffer.resize(std::size_t(width) * height * 3);
+
+    cellSize = std::max(1, std::min(width / layoutColumns, height / layoutRows));
+    originX = (width - cellSize * layoutColumns) / 2;
+    originY = (height - cellSize * layoutRows) / 2;
+
+    // same colours as the opengl frontend
+    squareColours[Empty] = convert(77, 77, 77);
+    squareColours[Cyan] = convert(0, 255, 255);
+    squareColours[Blue] = convert(0, 0, 255);
+    squareColours[Orange] = convert(255, 165, 0);
+    squareColours[Yellow] = convert(255, 255, 0);
+    squareColours[Green] = convert(0, 255, 0);
+    squareColours[Pink] = convert(255, 105, 180);
+    squareColours[Red] = convert(255, 0, 0);
+    emptyEven = convert(77, 77, 77);
+    emptyOdd = convert(102, 102, 102);
+    background = convert(26, 26, 26);
+    border = convert(140, 140, 140);
+    textColour = convert(230, 230, 230);
+}
+
+void SoftwareRenderer::draw(Game& game)
+{
+    fillRect(0, 0, width, height, background);
+
+    // board, the border shows through the gaps between cells as grid lines
+    int gap = std::max(1, cellSize / 16);
+    fillRect(originX + cellSize - gap, originY + cellSize - gap,
+      originX + cellSize * (WIDTH + 1) + gap, originY + cellSize * (HEIGHT + 1) + gap, border);
+    auto grid = game.getGridWithActive();
+    for (int x = 0; x < WIDTH; x++) {
+        for (int y = 0; y < HEIGHT; y++) {
+            Square s = grid[x][y];
+            Pixel p = s != Empty ? squareColours[s] : x % 2 == 0 ? emptyEven : emptyOdd;
+            fillCell(1 + x, HEIGHT - y, p);
+        }
+    }
+
+    // side panel
+    if (Tetromino* carry = game.getCarryPiece())
+        drawPiece(panelColumn, 1, carry->getDefaultLocation(), carry->getColour());
+    int row = 4;
+    for (auto& piece : game.getUpcoming()) {
+        if (row + 2 > layoutRows - 4) break;
+        drawPiece(panelColumn, row, piece->getDefaultLocation(), piece->getColour());
+        row += 3;
+    }
+    drawNumber(panelColumn, layoutRows - 3, game.getScore());
+}
+
+bool SoftwareRenderer::writePPM(std::FILE* f)
+{
+    if (format != RGB) return false;
+    if (std::fprintf(f, "P6\n%d %d\n255\n", width, height) < 0) return false;
+    return std::fwrite(framebuffer.data(), 1, framebuffer.size(), f) == framebuffer.size();
+}
+
+bool SoftwareRenderer::writeY4MHeader(std::FILE* f, int fps)
+{
+    if (format != YUV444) return false;
+    return std::fprintf(f, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, fps) >= 0;
+}
+
+bool SoftwareRenderer::writeY4MFrame(std::FILE* f)
+{
+    if (format != YUV444) return false;
+    if (std::fputs("FRAME\n", f) < 0) return false;
+    return std::fwrite(framebuffer.data(), 1, framebuffer.size(), f) == framebuffer.size();
+}
+
+bool SoftwareRenderer::writeRaw(std::FILE* f)
+{
+    return std::fwrite(framebuffer.data(), 1, framebuffer.size(), f) == framebuffer.size();
+}
+
+int SoftwareRenderer::getWidth() { return width; }
+
+int SoftwareRenderer::getHeight() { return height; }
+
+SoftwareRenderer::Format SoftwareRenderer::getFormat() { return format; }
+
+SoftwareRenderer::Pixel SoftwareRenderer::convert(std::uint8_t r, std::uint8_t g, std::uint8_t b)
+{
+    if (format == RGB) return {r, g, b};
+    // bt.601 limited range, which is what y4m consumers assume
+    double y = 16 + (65.481 * r + 128.553 * g + 24.966 * b) / 255;
+    double cb = 128 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255;
+    double cr = 128 + (112.0 * r - 93.786 * g - 18.214 * b) / 255;
+    return {std::uint8_t(y + 0.5), std::uint8_t(cb + 0.5), std::uint8_t(cr + 0.5)};
+}
+
+void SoftwareRenderer::fillRect(int x0, int y0, int x1, int y1, Pixel p)
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, width);
+    y1 = std::min(y1, height);
+    if (x0 >= x1 || y0 >= y1) return;
+    std::size_t span = x1 - x0;
+
+    if (format == YUV444) {
+        std::size_t plane = std::size_t(width) * height;
+        for (int c = 0; c < 3; c++) {
+            std::uint8_t* base = framebuffer.data() + c * plane + std::size_t(y0) * width + x0;
+            for (int y = y0; y < y1; y++, base += width)
+                std::memset(base, p[c], span);
+        }
+        return;
+    }
+
+    // write one pixel, then keep doubling the filled part of the first scanline, and copy
+    // that scanline down the rest of the rectangle
+    std::size_t stride = std::size_t(width) * 3;
+    std::uint8_t* first = framebuffer.data() + std::size_t(y0) * stride + std::size_t(x0) * 3;
+    std::size_t bytes = span * 3;
+    std::memcpy(first, p.data(), 3);
+    for (std::size_t filled = 3; filled < bytes; filled *= 2)
+        std::memcpy(first + filled, first, std::min(filled, bytes - filled));
+    std::uint8_t* line = first + stride;
+    for (int y = y0 + 1; y < y1; y++, line += stride)
+        std::memcpy(line, first, bytes);
+}
+
+void SoftwareRenderer::fillCell(int cx, int cy, Pixel p)
+{
+    int gap = std::max(1, cellSize / 16);
+    int x = originX + cx * cellSize;
+    int y = originY + cy * cellSize;
+    fillRect(x, y, x + cellSize - gap, y + cellSize - gap, p);
+}
+
+void SoftwareRenderer::drawPiece(
+  int cx, int cy, std::array<std::pair<int, int>, 4> location, Square colour)
+{
+    int minX = INT_MAX;
+    int maxY = INT_MIN;
+    for (auto coord : location) {
+        minX = std::min(minX, coord.first);
+        maxY = std::max(maxY, coord.second);
+    }
+    for (auto coord : location)
+        fillCell(cx + coord.first - minX, cy + maxY - coord.second, squareColours[colour]);
+}
+
+void SoftwareRenderer::drawNumber(int cx, int cy, unsigned int n)
+{
+    // digits are 3 font pixels wide with a 1 pixel gap, 4 digits fit in a cell
+    int scale = std::max(1, cellSize / 4);
+    std::array<int, 10> digits;
+    int count = 0;
+    do {
+        digits[count++] = n % 10;
+        n /= 10;
+    } while (n > 0 && count < 10);
+    int x = originX + cx * cellSize;
+    int y = originY + cy * cellSize;
+    for (int i = count - 1; i >= 0; i--, x += 4 * scale) {
+        auto& glyph = digitFont[digits[i]];
+        for (int row = 0; row < 5; row++) {
+            for (int col = 0; col < 3; col++) {
+                if (glyph[row] & (4 >> col))
+                    fillRect(x + col * scale, y + row * scale, x + (col + 1) * scale,
+                      y + (row + 1) * scale, textColour);
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef SOFTWARE_H_
+#define SOFTWARE_H_
+
+#include "dimensions.hpp"
+#include "enums.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+class Game;
+
+// offscreen renderer, rasterises a game into a framebuffer in memory without any opengl
+// context, for turning games into images and video on machines without a gpu
+//
+// everything drawn is an axis aligned rectangle of one colour, so each rectangle is filled
+// one scanline at a time with memset/memcpy, which the c library already vectorises. the
+// framebuffer is kept in the pixel format that will be written out, so no conversion pass
+// is needed per frame
+
+class SoftwareRenderer
+{
+public:
+    enum Format {
+        RGB,  // interleaved 8 bit rgb, for ppm and raw output
+        YUV444  // planar 8 bit Y'CbCr (bt.601, limited range), for y4m output
+    };
+
+    SoftwareRenderer(int width, int height, Format);
+
+    // draw the board, active piece, hold, preview queue and score
+    void draw(Game&);
+
+    // write the current frame as a binary ppm (P6), only for RGB
+    bool writePPM(std::FILE*);
+
+    // write the stream header once, then one frame per call, only for YUV444
+    bool writeY4MHeader(std::FILE*, int fps);
+    bool writeY4MFrame(std::FILE*);
+
+    // write the bare framebuffer, rgb24 or yuv444p depending on the format
+    bool writeRaw(std::FILE*);
+
+    int getWidth();
+    int getHeight();
+    Format getFormat();
+
+private:
+    // a colour already converted to the framebuffer format, three channels either way
+    typedef std::array<std::uint8_t, 3> Pixel;
+
+    int width;
+    int height;
+    Format format;
+
+    // RGB: one plane of width * height * 3 bytes
+    // YUV444: three planes of width * height bytes each
+    std::vector<std::uint8_t> framebuffer;
+
+    // layout, in pixels, computed from the resolution
+    int cellSize;
+    int originX;
+    int originY;
+
+    // colours for each square type, plus background, border and text, in framebuffer format
+    std::array<Pixel, 8> squareColours;
+    Pixel emptyEven;
+    Pixel emptyOdd;
+    Pixel background;
+    Pixel border;
+    Pixel textColour;
+
+    Pixel convert(std::uint8_t r, std::uint8_t g, std::uint8_t b);
+
+    // fill [x0, x1) x [y0, y1), clipped to the framebuffer
+    void fillRect(int x0, int y0, int x1, int y1, Pixel);
+
+    // fill a board-sized square at cell coordinates, with a one pixel gap as a grid line
+    void fillCell(int cx, int cy, Pixel);
+
+    void drawPiece(int cx, int cy, std::array<std::pair<int, int>, 4>, Square);
+    void drawNumber(int cx, int cy, unsigned int);
+};
+
+#endif  // SOFTWARE_H_
@@ -0,0 +1,232 @@
+#include "broadcast.hpp"
+#include "game.hpp"
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// spectators watching matches through Broadcasters, over local sockets
+//
+// every match is a DelayLock game ticked every tick with random inputs and published to its
+// Broadcaster once a tick. every spectator reads from its own socketpair into a
+// SpectatorView. most read all there is every tick and must see their match exactly as it is
+// after every flush, the slow ones read a little every so often and fall behind, so they are
+// sent keyframes or dropped. half of the spectators join part way through, and start from a
+// keyframe and the tail after it. at the end every spectator left must have caught up
+//
+//   tetris-spectate [-x] [-m matches] [-c spectators] [-t ticks] [-w slow percent] [-s seed]
+//
+// -x drops slow spectators instead of sending them keyframes
+
+namespace {
+
+// ticks between the reads of a slow spectator, and the most it reads then
+constexpr int slowEvery = 60;
+constexpr std::size_t slowRead = 64;
+
+// the socket buffer of a spectator, small so that slow ones back up into the broadcaster
+constexpr int socketBuffer = 16 << 10;
+
+struct Match
+{
+    std::unique_ptr<Game> game;
+    std::unique_ptr<Broadcaster> broadcaster;
+    Snapshot snapshot;
+};
+
+struct Viewer
+{
+    int match = 0;
+    int joinTick = 0;
+    bool slow = false;
+
+    // the spectator's end of the socket, -1 before it joins and after it is dropped
+    int fd = -1;
+    SpectatorView view;
+};
+
+// whether a view shows a match as it is
+bool shows(SpectatorView& view, const Snapshot& snapshot)
+{
+    return view.isSynced() && !encodeDelta(view.getSnapshot(), snapshot);
+}
+
+// read up to a limit, false once the broadcaster has closed the socket
+bool readInto(Viewer& viewer, std::size_t limit, std::uint64_t& bytes)
+{
+    std::uint8_t buffer[4096];
+    while (limit > 0) {
+        ssize_t n = read(viewer.fd, buffer, std::min(limit, sizeof(buffer)));
+        if (n == 0) return false;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        if (!viewer.view.feed(buffer, n)) {
+            std::cerr << "a spectator could not decode its stream" << std::endl;
+            std::exit(1);
+        }
+        bytes += n;
+        limit -= n;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    BroadcastOptions options;
+    options.maxQueued = 16 << 10;
+    int matches = 4;
+    int spectators = 500;
+    int ticks = 6000;
+    int slowPercent = 10;
+    unsigned int seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "xm:c:t:w:s:")) != -1) {
+        switch (opt) {
+        case 'x': options.dropSlow = true; break;
+        case 'm': matches = std::atoi(optarg); break;
+        case 'c': spectators = std::atoi(optarg); break;
+        case 't': ticks = std::atoi(optarg); break;
+        case 'w': slowPercent = std::atoi(optarg); break;
+        case 's': seed = std::strtoul(optarg, nullptr, 10); break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-x] [-m matches] [-c spectators] [-t ticks]"
+                      << " [-w slow percent] [-s seed]" << std::endl;
+            return -1;
+        }
+    }
+    if (matches <= 0 || spectators <= 0 || ticks <= 0 || slowPercent < 0 || slowPercent > 100)
+        return -1;
+
+    std::mt19937 engine(seed);
+    unsigned int nextSeed = seed;
+    std::vector<Match> games(matches);
+    for (Match& match : games) {
+        match.game = std::make_unique<Game>(nextSeed++, DelayLock);
+        match.broadcaster = std::make_unique<Broadcaster>(options);
+    }
+    std::vector<Viewer> viewers(spectators);
+    for (int i = 0; i < spectators; i++) {
+        viewers[i].match = i % matches;
+        viewers[i].slow = i * 100 / spectators < slowPercent;
+        viewers[i].joinTick = i % 2 ? 1 + int(engine() % ticks) : 1;
+    }
+
+    std::chrono::duration<double> publishTime(0), flushTime(0);
+    std::uint64_t read = 0, viewerTicks = 0;
+    std::uniform_int_distribution<int> action(ActionNone, ActionHarddrop * 3);
+    for (int tick = 1; tick <= ticks; tick++) {
+        for (Viewer& viewer : viewers) {
+            if (viewer.joinTick != tick) continue;
+            int ends[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+                std::cerr << "could not make a socket pair" << std::endl;
+                return 1;
+            }
+            setsockopt(ends[0], SOL_SOCKET, SO_SNDBUF, &socketBuffer, sizeof(socketBuffer));
+            fcntl(ends[1], F_SETFL, fcntl(ends[1], F_GETFL) | O_NONBLOCK);
+            games[viewer.match].broadcaster->subscribe(ends[0]);
+            viewer.fd = ends[1];
+        }
+
+        // most ticks have no input, so pieces fall and lock as well as move
+        auto start = std::chrono::steady_clock::now();
+        for (Match& match : games) {
+            int a = action(engine);
+            if (a <= ActionHarddrop) match.game->apply(Action(a));
+            match.game->tick();
+            if (match.game->isGameOver())
+                match.game = std::make_unique<Game>(nextSeed++, DelayLock);
+            match.snapshot.capture(*match.game, tick);
+            match.broadcaster->publish(match.snapshot);
+        }
+        auto published = std::chrono::steady_clock::now();
+        for (Match& match : games)
+            match.broadcaster->flush();
+        auto flushed = std::chrono::steady_clock::now();
+        publishTime += published - start;
+        flushTime += flushed - published;
+
+        for (Viewer& viewer : viewers) {
+            if (viewer.fd < 0) continue;
+            viewerTicks++;
+            if (viewer.slow && tick % slowEvery != 0) continue;
+            if (!readInto(viewer, viewer.slow ? slowRead : SIZE_MAX, read)) {
+                close(viewer.fd);
+                viewer.fd = -1;
+                continue;
+            }
+            if (!viewer.slow && !shows(viewer.view, games[viewer.match].snapshot)) {
+                std::cerr << "tick " << tick << ": a spectator does not see its match as it is"
+                          << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // the slow ones catch up once the matches stop
+    for (std::uint64_t before = read - 1; before != read;) {
+        before = read;
+        for (Match& match : games)
+            match.broadcaster->flush();
+        for (Viewer& viewer : viewers) {
+            if (viewer.fd >= 0 && !readInto(viewer, SIZE_MAX, read)) {
+                close(viewer.fd);
+                viewer.fd = -1;
+            }
+        }
+    }
+    int left = 0;
+    for (Viewer& viewer : viewers) {
+        if (viewer.fd < 0) continue;
+        left++;
+        if (!shows(viewer.view, games[viewer.match].snapshot)) {
+            std::cerr << "a spectator did not catch up with its match" << std::endl;
+            return 1;
+        }
+        close(viewer.fd);
+    }
+
+    BroadcastStats total;
+    for (Match& match : games) {
+        const BroadcastStats& stats = match.broadcaster->getStats();
+        total.frames += stats.frames;
+        total.keyframes += stats.keyframes;
+        total.encodedBytes += stats.encodedBytes;
+        total.writes += stats.writes;
+        total.sentBytes += stats.sentBytes;
+        total.resyncs += stats.resyncs;
+        total.dropped += stats.dropped;
+    }
+    // what encoding the whole match for every spectator every tick would cost instead
+    const int encodes = 10000;
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t sink = 0;
+    for (int i = 0; i < encodes; i++)
+        sink += encodeKeyframe(games[i % matches].snapshot)->size();
+    std::chrono::duration<double> encodeTime = std::chrono::steady_clock::now() - start;
+
+    std::cout << left << " of " << spectators << " spectators caught up, " << total.resyncs
+              << " sent keyframes to catch up, " << total.dropped << " dropped" << std::endl;
+    std::cout << total.frames << " frames and " << total.keyframes << " keyframes encoded, "
+              << double(total.encodedBytes) / (total.frames + total.keyframes)
+              << " bytes each, " << total.sentBytes << " bytes sent in " << total.writes
+              << " writes" << std::endl;
+    std::cout << "per spectator and tick: flush " << flushTime.count() * 1e9 / viewerTicks
+              << " ns, against " << encodeTime.count() * 1e9 / encodes << " ns to encode the"
+              << " whole match (" << sink / encodes << " bytes); publish "
+              << publishTime.count() * 1e9 / (std::uint64_t(ticks) * matches)
+              << " ns per match and tick" << std::endl;
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "game.hpp"
+#include "terminal.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <random>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+// terminal frontend, plays the same game as the opengl one without needing a display
+
+bool processInput(Game&);
+
+void enableRawMode();
+void restoreTerminal();
+void handleSignal(int);
+
+termios originalTermios;
+volatile std::sig_atomic_t quit = 0;
+volatile std::sig_atomic_t resized = 0;
+
+// the start of an arrow key sequence that the last read ended in, ESC or ESC [, and when it
+// arrived. the rest can come in a later read, over ssh or when held keys back up, so it only
+// counts as a lone ESC once nothing has followed it for a while
+char pending[2];
+int pendingCount = 0;
+std::chrono::steady_clock::time_point pendingSince;
+constexpr std::chrono::milliseconds escapeWait(100);
+
+int main()
+{
+    if (!isatty(STDIN_FILENO)) {
+        std::cerr << "stdin is not a terminal" << std::endl;
+        return -1;
+    }
+    enableRawMode();
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+    std::signal(SIGWINCH, handleSignal);
+
+    std::random_device device;
+    Game game(device(), DelayLock);
+    unsigned int score;
+    {
+        TerminalRenderer renderer;
+
+        // one game tick per frame
+        std::chrono::steady_clock::duration frameTime = std::chrono::microseconds(16667);
+        auto nextFrame = std::chrono::steady_clock::now();
+        while (!quit && !game.isGameOver()) {
+            if (!processInput(game)) break;
+
+            game.tick();
+
+            if (resized) {
+                resized = 0;
+                renderer.invalidate();
+            }
+            renderer.draw(game);
+            renderer.present();
+
+            nextFrame += frameTime;
+            std::this_thread::sleep_until(nextFrame);
+        }
+        score = game.getScore();
+    }
+    restoreTerminal();
+    std::cout << "score: " << score << std::endl;
+    return 0;
+}
+
+// read whatever keys arrived since the last frame, returns false when the player quits
+bool processInput(Game& game)
+{
+    char buf[sizeof(pending) + 64];
+    int carried = pendingCount;
+    std::copy(pending, pending + carried, buf);
+    ssize_t got = read(STDIN_FILENO, buf + carried, 64);
+    int n = carried + std::max<ssize_t>(got, 0);
+    if (n == carried && carried > 0)
+        return std::chrono::steady_clock::now() - pendingSince < escapeWait;
+
+    pendingCount = 0;
+    for (int i = 0; i < n; i++) {
+        // arrow keys arrive as ESC [ A-D, a lone ESC quits
+        if (buf[i] == '\x1b') {
+            if (i + 1 == n || (i + 2 == n && buf[i + 1] == '[')) {
+                // the rest may still be on its way
+                if (i > 0 || carried == 0) pendingSince = std::chrono::steady_clock::now();
+                pendingCount = n - i;
+                std::copy(buf + i, buf + n, pending);
+                break;
+            }
+            if (buf[i + 1] == '[') {
+                switch (buf[i + 2]) {
+                case 'A': game.rotate(Clockwise); break;
+                case 'B': game.softdrop(); break;
+                case 'C': game.moveHorizontal(1); break;
+                case 'D': game.moveHorizontal(-1); break;
+                }
+                i += 2;
+                continue;
+            }
+            return false;
+        }
+        switch (buf[i]) {
+        case 'q': return false;
+        case 'h': game.moveHorizontal(-1); break;
+        case 'l': game.moveHorizontal(1); break;
+        case 'k':
+        case 'z': game.rotate(Clockwise); break;
+        case 'x': game.rotate(CounterClockwise); break;
+        case 'j': game.softdrop(); break;
+        case ' ': game.harddrop(); break;
+        case 'c': game.hold(); break;
+        }
+    }
+    return true;
+}
+
+void enableRawMode()
+{
+    tcgetattr(STDIN_FILENO, &originalTermios);
+    termios raw = originalTermios;
+    raw.c_lflag &= ~(ECHO | ICANON);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    // reads return immediately with whatever is available
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+}
+
+void restoreTerminal() { tcsetattr(STDIN_FILENO, TCSAFLUSH, &originalTermios); }
+
+void handleSignal(int sig)
+{
+    if (sig == SIGWINCH)
+        resized = 1;
+    else
+        quit = 1;
+}
@@ -0,0 +1,202 @@
+#include "terminal.hpp"
+
+#include "game.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+
+namespace {
+
+// 256 colour palette entries for each square type, empty squares alternate by column
+// like the opengl frontend
+constexpr std::uint8_t emptyEven = 236;
+constexpr std::uint8_t emptyOdd = 238;
+constexpr std::uint8_t border = 244;
+
+std::uint8_t paletteOf(Square s)
+{
+    switch (s) {
+    case Cyan: return 51;
+    case Blue: return 21;
+    case Orange: return 208;
+    case Yellow: return 226;
+    case Green: return 46;
+    case Pink: return 205;
+    case Red: return 196;
+    default: return 0;
+    }
+}
+
+}  // namespace
+
+TerminalRenderer::TerminalRenderer(int f) : fd(f)
+{
+    out.reserve(columns * rows * 16);
+    // alternate screen, hide cursor, clear
+    writeAll("\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J");
+}
+
+TerminalRenderer::~TerminalRenderer() { writeAll("\x1b[0m\x1b[?25h\x1b[?1049l"); }
+
+void TerminalRenderer::draw(Game& game)
+{
+    back.fill(Cell());
+
+    // board and its border
+    auto grid = game.getGridWithActive();
+    for (int row = 0; row < HEIGHT + 2; row++) {
+        put(0, row, ' ', 0, border);
+        put(boardColumns - 1, row, ' ', 0, border);
+    }
+    for (int col = 1; col < boardColumns - 1; col++) {
+        put(col, 0, ' ', 0, border);
+        put(col, HEIGHT + 1, ' ', 0, border);
+    }
+    for (int x = 0; x < WIDTH; x++) {
+        for (int y = 0; y < HEIGHT; y++) {
+            int row = HEIGHT - y;
+            Square s = grid.at(x).at(y);
+            if (s == Empty) {
+                std::uint8_t bg = x % 2 == 0 ? emptyEven : emptyOdd;
+                put(1 + 2 * x, row, ' ', 0, bg);
+                put(2 + 2 * x, row, ' ', 0, bg);
+            } else {
+                square(1 + 2 * x, row, s);
+            }
+        }
+    }
+
+    // side panel
+    text(panelColumn, 1, "HOLD");
+    if (Tetromino* carry = game.getCarryPiece())
+        preview(panelColumn, 2, carry->getDefaultLocation(), carry->getColour());
+
+    text(panelColumn, 5, "NEXT");
+    int row = 6;
+    for (auto& piece : game.getUpcoming()) {
+        if (row + 1 >= rows) break;
+        preview(panelColumn, row, piece->getDefaultLocation(), piece->getColour());
+        row += 3;
+    }
+
+    text(panelColumn, rows - 4, "SCORE");
+    text(panelColumn, rows - 3, std::to_string(game.getScore()));
+
+    if (game.isGameOver()) text(boardColumns / 2 - 4, HEIGHT / 2, "GAME OVER");
+}
+
+void TerminalRenderer::present()
+{
+    out.clear();
+    // unknown cursor position and attributes force the first changed cell to emit both
+    int cursorRow = -1;
+    int cursorCol = -1;
+    int fg = -1;
+    int bg = -1;
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < columns; col++) {
+            int i = row * columns + col;
+            const Cell& cell = back[i];
+            if (!fullRedraw && cell == front[i]) continue;
+            if (row != cursorRow || col != cursorCol) {
+                out += "\x1b[";
+                appendNumber(row + 1);
+                out += ';';
+                appendNumber(col + 1);
+                out += 'H';
+            }
+            if (cell.fg != fg || cell.bg != bg) {
+                out += "\x1b[";
+                if (cell.fg == 0) {
+                    out += "39";
+                } else {
+                    out += "38;5;";
+                    appendNumber(cell.fg);
+                }
+                if (cell.bg == 0) {
+                    out += ";49";
+                } else {
+                    out += ";48;5;";
+                    appendNumber(cell.bg);
+                }
+                out += 'm';
+                fg = cell.fg;
+                bg = cell.bg;
+            }
+            out += cell.ch;
+            cursorRow = row;
+            cursorCol = col + 1;
+            front[i] = cell;
+        }
+    }
+    fullRedraw = false;
+    if (out.empty()) return;
+    out += "\x1b[0m";
+    writeAll(out);
+}
+
+void TerminalRenderer::invalidate()
+{
+    fullRedraw = true;
+    writeAll("\x1b[0m\x1b[2J");
+}
+
+void TerminalRenderer::put(int col, int row, char ch, std::uint8_t fg, std::uint8_t bg)
+{
+    if (col < 0 || col >= columns || row < 0 || row >= rows) return;
+    back[row * columns + col] = Cell{ch, fg, bg};
+}
+
+void TerminalRenderer::text(int col, int row, const std::string& s)
+{
+    for (std::size_t i = 0; i < s.size(); i++)
+        put(col + i, row, s[i], 0, 0);
+}
+
+void TerminalRenderer::square(int col, int row, Square s)
+{
+    put(col, row, ' ', 0, paletteOf(s));
+    put(col + 1, row, ' ', 0, paletteOf(s));
+}
+
+void TerminalRenderer::preview(
+  int col, int row, std::array<std::pair<int, int>, 4> location, Square colour)
+{
+    int minX = INT_MAX;
+    int maxY = INT_MIN;
+    for (auto coord : location) {
+        minX = std::min(minX, coord.first);
+        maxY = std::max(maxY, coord.second);
+    }
+    // y goes up on the board, rows go down on the screen
+    for (auto coord : location)
+        square(col + 2 * (coord.first - minX), row + maxY - coord.second, colour);
+}
+
+void TerminalRenderer::appendNumber(int n)
+{
+    char digits[12];
+    int len = 0;
+    do {
+        digits[len++] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    while (len > 0)
+        out += digits[--len];
+}
+
+void TerminalRenderer::writeAll(const std::string& s)
+{
+    const char* p = s.data();
+    std::size_t left = s.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        p += n;
+        left -= n;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef TERMINAL_H_
+#define TERMINAL_H_
+
+#include "dimensions.hpp"
+#include "enums.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+
+class Game;
+
+// terminal frontend, draws a game with ANSI escape codes
+//
+// frames are drawn into a back buffer of character cells, then present() compares it with
+// the front buffer (what the terminal currently shows) and emits only the cells that
+// changed, all in a single write(). an idle frame costs nothing, a falling piece costs a
+// few dozen bytes, which keeps 60 fps over ssh cheap
+
+class TerminalRenderer
+{
+public:
+    // switches the terminal to the alternate screen and hides the cursor
+    TerminalRenderer(int fd = STDOUT_FILENO);
+
+    // restores the normal screen and cursor
+    ~TerminalRenderer();
+
+    TerminalRenderer(const TerminalRenderer&) = delete;
+    TerminalRenderer& operator=(const TerminalRenderer&) = delete;
+
+    // draw the board, hold, preview queue and score into the back buffer
+    void draw(Game&);
+
+    // send the difference between the back and front buffers to the terminal
+    void present();
+
+    // forget what the terminal shows, so the next present() redraws everything
+    // needed after a resize or anything else scribbling on the screen
+    void invalidate();
+
+private:
+    // a character cell, colours are indices into the 256 colour palette, 0 meaning the
+    // terminal's default colour
+    struct Cell
+    {
+        char ch = ' ';
+        std::uint8_t fg = 0;
+        std::uint8_t bg = 0;
+
+        bool operator==(const Cell& o) const { return ch == o.ch && fg == o.fg && bg == o.bg; }
+        bool operator!=(const Cell& o) const { return !(*this == o); }
+    };
+
+    // each square is two characters wide, so that squares look roughly square
+    static constexpr int boardColumns = 2 * WIDTH + 2;
+    static constexpr int panelColumn = boardColumns + 2;
+    static constexpr int panelWidth = 12;
+    static constexpr int columns = panelColumn + panelWidth;
+    static constexpr int rows = HEIGHT + 2 > 24 ? HEIGHT + 2 : 24;
+
+    std::array<Cell, columns * rows> front;
+    std::array<Cell, columns * rows> back;
+
+    // set by invalidate(), makes present() emit every cell
+    bool fullRedraw = true;
+
+    // reused between frames so that presenting does not allocate
+    std::string out;
+
+    int fd;
+
+    void put(int col, int row, char ch, std::uint8_t fg, std::uint8_t bg);
+    void text(int col, int row, const std::string& s);
+    void square(int col, int row, Square);
+
+    // draw a piece in its spawn orientation with the top left of its bounding box at
+    // col, row
+    void preview(int col, int row, std::array<std::pair<int, int>, 4>, Square);
+
+    void appendNumber(int);
+    void writeAll(const std::string&);
+};
+
+#endif  // TERMINAL_H_
@@ -0,0 +1,100 @@
+#ifndef TETRIS_ENV_H_
+#define TETRIS_ENV_H_
+
+/*
+ * C interface to a batch of headless games, for reinforcement learning
+ *
+ * an environment holds a fixed number of sessions which are all stepped together. the
+ * caller owns every buffer: observations, rewards and done flags are written straight into
+ * the arrays passed to tetris_env_step_batch, one entry per session, nothing is copied or
+ * allocated per step. sessions are stepped in parallel on a pool of threads owned by the
+ * environment
+ *
+ * a session whose game ended is started again with a new seed in the same step, its done
+ * flag is set and its observation is the first of the new game
+ *
+ * built as bin/libtetris_env.so, e.g. from python with ctypes or numpy.ctypeslib:
+ *
+ *   env = lib.tetris_env_create(1024, 10, 1, 0)
+ *   lib.tetris_env_reset(env, obs)
+ *   lib.tetris_env_step_batch(env, actions, obs, rewards, dones)
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TETRIS_ENV_ABI_VERSION 1
+
+#define TETRIS_ENV_WIDTH 10
+#define TETRIS_ENV_HEIGHT 22
+#define TETRIS_ENV_PREVIEW 4
+
+/* actions, one per session per step */
+enum tetris_action {
+    TETRIS_ACTION_NONE = 0,
+    TETRIS_ACTION_LEFT = 1,
+    TETRIS_ACTION_RIGHT = 2,
+    TETRIS_ACTION_ROTATE_CW = 3,
+    TETRIS_ACTION_ROTATE_CCW = 4,
+    TETRIS_ACTION_SOFT_DROP = 5,
+    TETRIS_ACTION_HARD_DROP = 6,
+    TETRIS_ACTION_HOLD = 7,
+    TETRIS_ACTION_COUNT = 8
+};
+
+/* pieces use the values of enum Piece: I J L O S T Z = 0..6, -1 for none */
+typedef struct tetris_obs {
+    /* locked squares, bit x of rows[y] is column x, row 0 is the bottom */
+    uint16_t rows[TETRIS_ENV_HEIGHT];
+
+    /* active piece, x and y are the origin its rotation layouts are relative to */
+    int8_t piece;
+    int8_t rotation;
+    int8_t x;
+    int8_t y;
+
+    int8_t hold;
+    int8_t can_hold;
+    int8_t queue[TETRIS_ENV_PREVIEW];
+    int8_t padding[2];
+
+    uint32_t score;
+    uint32_t pieces;
+} tetris_obs;
+
+typedef struct tetris_env tetris_env;
+
+uint32_t tetris_env_abi_version(void);
+
+/*
+ * sessions: number of games stepped together
+ * gravity_steps: gravity moves the active piece down once every this many steps
+ * seed: session i of episode e is seeded from (seed, i, e), so runs are reproducible
+ * threads: worker threads to step with, 0 for one per core
+ * returns NULL if the arguments are invalid
+ */
+tetris_env* tetris_env_create(int sessions, int gravity_steps, uint64_t seed, int threads);
+
+void tetris_env_destroy(tetris_env* env);
+
+int tetris_env_sessions(const tetris_env* env);
+
+/* start every session again and write the first observations, obs has sessions entries */
+void tetris_env_reset(tetris_env* env, tetris_obs* obs);
+
+/*
+ * apply actions[i] to session i, then gravity if due
+ * rewards[i] is the score gained this step, dones[i] is 1 if the game ended
+ * any of obs, rewards and dones may be NULL if the caller does not want them
+ */
+void tetris_env_step_batch(tetris_env* env, const int32_t* actions, tetris_obs* obs,
+  float* rewards, uint8_t* dones);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TETRIS_ENV_H_ */
@@ -2,21 +2,16 @@
 
 #include "enums.hpp"
 #include "playfield.hpp"
+#include "timing.hpp"
 
-#include <chrono>
+#include <algorithm>
 #include <utility>
 
 Tetromino::Tetromino(Playfield* p) { playfield = p; }
 
-void Tetromino::rotate(Rotation r)
+bool Tetromino::rotate(Rotation r)
 {
-    if (!moveable) return;
-    // do nothing if the last rotation was too recent to be intentional
-    auto currentTime = std::chrono::system_clock::now();
-    if (currentTime - lastRotation < rotationTimeout)
-        return;
-    else
-        lastRotation = currentTime;
+    if (!moveable) return false;
     auto newR = r == Clockwise              ? (rotationIdentifier + 1) % 4
                 : (rotationIdentifier == 0) ? 3
                                             : rotationIdentifier - 1;
@@ -37,9 +32,10 @@ void Tetromino::rotate(Rotation r)
     std::array<std::pair<int, int>, 4> kickedNewLocation;
     for (kickTry = 0; kickTry < 5; kickTry++) {
         int dX =
-          r == Clockwise ? kicks.at(r).at(kickTry).first : -1 * kicks.at(newR).at(kickTry).first;
-        int dY =
-          r == Clockwise ? kicks.at(r).at(kickTry).second : -1 * kicks.at(newR).at(kickTry).second;
+          r == Clockwise ? kicks.at(rotationIdentifier).at(kickTry).first
+                         : -1 * kicks.at(newR).at(kickTry).first;
+        int dY = r == Clockwise ? kicks.at(rotationIdentifier).at(kickTry).second
+                                : -1 * kicks.at(newR).at(kickTry).second;
         for (int i = 0; i < 4; i++) {
             kickedNewLocation.at(i) =
               std::make_pair<int, int>(newLocation.at(i).first + dX, newLocation.at(i).second + dY);
@@ -58,7 +54,13 @@ void Tetromino::rotate(Rotation r)
         trueLocation = newLocation;
         rotationIdentifier = newR;
         set = false;
+        lastKick = kickTry;
+        lastMoveKick = kickTry;
+        resetLockDelay();
+    } else {
+        lastKick = -1;
     }
+    return !illegal;
 }
 
 void Tetromino::moveDownOrAdd()
@@ -77,6 +79,7 @@ void Tetromino::moveDownOrAdd()
         for (auto i = trueLocation.begin(); i < trueLocation.end(); i++) {
             i->second--;
         }
+        lastMoveKick = -1;
     }
     for (auto coord : trueLocation) {
         if (playfield->squareFull(coord.first, coord.second - 1)) set = true;
@@ -89,15 +92,9 @@ void Tetromino::harddrop()
         moveDownOrAdd();
 }
 
-void Tetromino::moveHorizontal(int dir)
+bool Tetromino::moveHorizontal(int dir)
 {
-    if (!moveable) return;
-    // do nothing if the last movement was too recent to be intentional
-    auto currentTime = std::chrono::system_clock::now();
-    if (currentTime - lastHorizontalMovement < movementTimeout)
-        return;
-    else
-        lastHorizontalMovement = currentTime;
+    if (!moveable) return false;
     std::array<std::pair<int, int>, 4> newTrueLocation;
     int d = (dir > 0) ? 1 : -1;
     for (int i = 0; i < 4; i++) {
@@ -112,27 +109,115 @@ void Tetromino::moveHorizontal(int dir)
     if (legal) {
         trueLocation = newTrueLocation;
         set = false;
+        lastMoveKick = -1;
+        resetLockDelay();
+    }
+    return legal;
+}
+
+int Tetromino::dropDistance()
+{
+    // each square can fall until the first full square below it in its column
+    int distance = std::numeric_limits<int>::max();
+    for (auto coord : trueLocation) {
+        int d = 0;
+        while (!playfield->squareFull(coord.first, coord.second - d - 1))
+            d++;
+        distance = std::min(distance, d);
+    }
+    return distance;
+}
+
+int Tetromino::fall(int cells)
+{
+    int d = std::min(cells, dropDistance());
+    if (d <= 0) return 0;
+    for (auto& coord : trueLocation)
+        coord.second -= d;
+    lastMoveKick = -1;
+    // off the stack for a while, the delay starts again when it lands
+    lockTicks = 0;
+    int y = getOrigin().second;
+    if (y < lowestY) {
+        lowestY = y;
+        lockResets = 0;
+    }
+    return d;
+}
+
+bool Tetromino::tick(int gravity)
+{
+    fall(gravityCells(gravityCarried, gravity));
+    if (dropDistance() > 0) return false;
+    lockTicks++;
+    return lockTicks >= lockDelayTicks || lockResets >= maxLockResets;
+}
+
+void Tetromino::lock()
+{
+    playfield->addTetromino(this);
+    added = true;
+}
+
+int Tetromino::getLockTicks() { return lockTicks; }
+
+int Tetromino::getLockResets() { return lockResets; }
+
+void Tetromino::rest(int ticks) { lockTicks += ticks; }
+
+void Tetromino::resetLockDelay()
+{
+    if (lockTicks > 0 && lockResets < maxLockResets) {
+        lockTicks = 0;
+        lockResets++;
     }
 }
 
 Square Tetromino::getColour() { return colour; }
 
+Piece Tetromino::getPiece() { return piece; }
+
+int Tetromino::getRotation() { return rotationIdentifier; }
+
+int Tetromino::getLastKick() { return lastKick; }
+
+int Tetromino::getLastMoveKick() { return lastMoveKick; }
+
+std::pair<int, int> Tetromino::getOrigin()
+{
+    auto layout = rotationBasicStates[rotationIdentifier];
+    return std::make_pair(trueLocation.at(0).first - layout.at(0).first,
+      trueLocation.at(0).second - layout.at(0).second);
+}
+
 std::array<std::pair<int, int>, 4> Tetromino::getTrueLocation() { return trueLocation; }
 
 std::array<std::pair<int, int>, 4> Tetromino::getDefaultLayout() { return rotationBasicStates[0]; }
 
+std::array<std::pair<int, int>, 4> Tetromino::getLayout(int r) { return rotationBasicStates.at(r); }
+
+std::array<std::array<std::pair<int, int>, 5>, 4> Tetromino::getKicks() { return kicks; }
+
+std::array<std::pair<int, int>, 4> Tetromino::getDefaultLocation() { return defaultLocation; }
+
 bool Tetromino::isAdded() { return added; }
 
 void Tetromino::resetPosition()
 {
     trueLocation = defaultLocation;
     rotationIdentifier = 0;
+    lastMoveKick = -1;
+    lockTicks = 0;
+    lockResets = 0;
+    lowestY = std::numeric_limits<int>::max();
+    gravityCarried = 0;
 }
 
 IPiece::IPiece(Playfield* p) : Tetromino(p)
 {
     playfield = p;
     colour = Cyan;
+    piece = I;
     defaultLocation = {std::make_pair<int, int>((WIDTH / 2) - 2, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2), HEIGHT - 1),
@@ -204,16 +289,24 @@ OPiece::OPiece(Playfield* p) : Tetromino(p)
 {
     playfield = p;
     colour = Yellow;
+    piece = O;
     defaultLocation = {std::make_pair<int, int>(WIDTH / 2, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2), HEIGHT),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT)};
     trueLocation = defaultLocation;
+    // The O piece does not move when it rotates, but a rotation still unsets it so that
+    // infinite is possible
+    std::array<std::pair<int, int>, 4> layout = {std::make_pair<int, int>(0, 0),
+      std::make_pair<int, int>(-1, 0),
+      std::make_pair<int, int>(0, 1),
+      std::make_pair<int, int>(-1, 1)};
+    rotationBasicStates = {layout, layout, layout, layout};
+    std::array<std::pair<int, int>, 5> noKicks;
+    noKicks.fill(std::make_pair<int, int>(0, 0));
+    kicks = {noKicks, noKicks, noKicks, noKicks};
 };
 
-// The O piece does not rotate, but infinite is still possible
-void OPiece::rotate(Rotation r) { set = false; }
-
 // all kicks are for clockwise rotations
 std::array<std::array<std::pair<int, int>, 5>, 4> JLZSTKicks = {{
   {
@@ -254,6 +347,7 @@ JPiece::JPiece(Playfield* p) : Tetromino(p)
 {
     playfield = p;
     colour = Blue;
+    piece = J;
     defaultLocation = {std::make_pair<int, int>((WIDTH / 2) - 2, HEIGHT),
       std::make_pair<int, int>((WIDTH / 2) - 2, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT - 1),
@@ -292,6 +386,7 @@ LPiece::LPiece(Playfield* p) : Tetromino(p)
 {
     playfield = p;
     colour = Orange;
+    piece = L;
     defaultLocation = {std::make_pair<int, int>((WIDTH / 2) - 2, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2), HEIGHT - 1),
@@ -330,6 +425,7 @@ ZPiece::ZPiece(Playfield* p) : Tetromino(p)
 {
     playfield = p;
     colour = Red;
+    piece = Z;
     defaultLocation = {std::make_pair<int, int>((WIDTH / 2) - 2, HEIGHT),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT - 1),
@@ -368,6 +464,7 @@ SPiece::SPiece(Playfield* p) : Tetromino(p)
 {
     playfield = p;
     colour = Green;
+    piece = S;
     defaultLocation = {std::make_pair<int, int>((WIDTH / 2) - 2, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT),
@@ -406,6 +503,7 @@ TPiece::TPiece(Playfield* p) : Tetromino(p)
 {
     playfield = p;
     colour = Pink;
+    piece = T;
     defaultLocation = {std::make_pair<int, int>((WIDTH / 2) - 2, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT - 1),
       std::make_pair<int, int>((WIDTH / 2) - 1, HEIGHT),
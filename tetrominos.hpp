@@ -5,8 +5,8 @@
 #include "enums.hpp"
 
 #include <array>
-#include <chrono>
 #include <iostream>
+#include <limits>
 #include <utility>
 
 class Playfield;
@@ -31,6 +31,17 @@ protected:
     // tetrominos have standard colours
     Square colour;
 
+    // which of the 7 tetrominos this is
+    Piece piece;
+
+    // index into kicks of the test used by the last successful rotation, -1 if the last
+    // rotation failed or there has not been one
+    int lastKick = -1;
+
+    // kick test of the rotation that last moved the piece, -1 if the piece has moved
+    // sideways or down since (or never rotated). a T-spin needs the rotation to be last
+    int lastMoveKick = -1;
+
     // a tetromino needs access to the playfield so that if it is possible for a piece to
     // rotate, whether it needs to kick etc.
     Playfield* playfield;
@@ -47,18 +58,24 @@ protected:
     // set to false after a hard drop
     bool moveable = true;
 
-    // when the tetromino was last moved horizontally and rotated, as well as a timeout, so
-    // that it is possible to react to rotations
-    std::chrono::system_clock::time_point lastRotation;
-    std::chrono::system_clock::time_point lastHorizontalMovement;
-    std::chrono::duration<float> rotationTimeout = std::chrono::milliseconds(95);
-    std::chrono::duration<float> movementTimeout = std::chrono::milliseconds(95);
+    // lock delay of DelayLock games: ticks spent resting since the delay last restarted,
+    // restarts used, the lowest row the origin has reached, which gives the restarts back,
+    // and the fraction of a cell of gravity carried to the next tick
+    int lockTicks = 0;
+    int lockResets = 0;
+    int lowestY = std::numeric_limits<int>::max();
+    int gravityCarried = 0;
+
+    // restart the lock delay after a move or rotation, if it is running and there are
+    // restarts left
+    void resetLockDelay();
 
 public:
     Tetromino(Playfield* p);
 
-    // specify whether to rotate clockwise or counter clockwise
-    void rotate(Rotation);
+    // specify whether to rotate clockwise or counter clockwise, returns whether the piece
+    // rotated. key repeat is up to the caller, every call is a rotation attempt
+    bool rotate(Rotation);
 
     // move the piece down by one
     void moveDownOrAdd();
@@ -66,17 +83,61 @@ public:
     // move the piece as far down as possible, then make it unmoveable
     void harddrop();
 
-    // move the piece one horizontally, left or right
+    // move the piece one horizontally, left or right, returns whether it moved
     // positive argument => right, negative => left
-    void moveHorizontal(int);
+    bool moveHorizontal(int);
+
+    // number of cells the piece can fall before it rests on something
+    int dropDistance();
+
+    // fall by up to the given number of cells in one move, stopping on the stack, returns
+    // how far it fell. never locks the piece
+    int fall(int);
+
+    // one tick of a DelayLock game: gravity in cells per tick (16.16 fixed point, see
+    // timing.hpp), then the lock delay if the piece is resting. returns whether it should lock
+    bool tick(int gravity);
+
+    // add the piece to the playfield where it is
+    void lock();
+
+    // the lock delay, for games that keep their own time instead of calling tick (see
+    // Session): ticks rested since it last restarted, restarts used, and counting ticks spent
+    // resting
+    int getLockTicks();
+    int getLockResets();
+    void rest(int ticks);
 
     // get the colour of a piece
     Square getColour();
 
+    // get which tetromino this is
+    Piece getPiece();
+
+    // get the rotation identifier 0-3
+    int getRotation();
+
+    // get the kick test used by the last successful rotation, -1 if it failed
+    int getLastKick();
+
+    // get the kick test of the rotation that last moved the piece, -1 if it was not a rotation
+    int getLastMoveKick();
+
+    // get the position that rotationBasicStates are relative to
+    std::pair<int, int> getOrigin();
+
     // get the location of the piece
     std::array<std::pair<int, int>, 4> getTrueLocation();
     std::array<std::pair<int, int>, 4> getDefaultLayout();
 
+    // get the logical positions of a rotation and the kick table, so that other engines can
+    // share the geometry of the pieces
+    std::array<std::pair<int, int>, 4> getLayout(int);
+    std::array<std::array<std::pair<int, int>, 5>, 4> getKicks();
+
+    // get the spawn location of the piece, used to draw it in the queue and hold
+    std::array<std::pair<int, int>, 4> getDefaultLocation();
+
     // get whether the piece is set/on ground
     bool isAdded();
 
@@ -96,7 +157,6 @@ class OPiece : public Tetromino
 {
 public:
     OPiece(Playfield*);
-    void rotate(Rotation);
 };
 
 class JPiece : public Tetromino
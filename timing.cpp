@@ -0,0 +1,14 @@
+#include "timing.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// the guideline curve for levels 1 to 20, worked out once rather than with pow at run time,
+// so that every build and every machine replays a game the same way
+const int gravityTable[20] = {1092, 1377, 1768, 2311, 3075, 4169, 5759, 8107, 11634, 17026,
+  25416, 38709, 60169, 95483, 154742, 256187, 433425, 749597, twentyG, twentyG};
+
+}  // namespace
+
+int gravityAt(int level) { return gravityTable[std::clamp(level, 1, 20) - 1]; }
@@ -0,0 +1,39 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include "dimensions.hpp"
+
+// game timing in ticks of the simulation, as used by DelayLock games (see LockMode)
+//
+// gravity is a number of cells per tick in 16.16 fixed point, taken from the guideline
+// curve: a row takes (0.8 - (level - 1) * 0.007) ^ (level - 1) seconds. a piece carries the
+// fraction left over from one tick to the next, and falls by the whole cells, all at once,
+// stopping on whatever is below it. from 20G on a piece goes straight to the floor
+
+constexpr int ticksPerSecond = 60;
+
+// ticks a piece may rest on the stack before it locks
+constexpr int lockDelayTicks = 30;
+
+// moves and rotations that restart the lock delay, per piece and per lowest row reached.
+// once they are used up the piece locks as soon as it touches down
+constexpr int maxLockResets = 15;
+
+constexpr int gravityOne = 1 << 16;
+constexpr int twentyG = 20 * gravityOne;
+
+// cells per tick at a level, 16.16 fixed point
+int gravityAt(int level);
+
+// whole cells to fall this tick, taken out of the fraction carried by the piece
+inline int gravityCells(int& carried, int gravity)
+{
+    // 20G and above drop a piece all the way in one tick, whatever is carried
+    if (gravity >= twentyG) return 2 * HEIGHT;
+    carried += gravity;
+    int cells = carried >> 16;
+    carried &= gravityOne - 1;
+    return cells;
+}
+
+#endif  // TIMING_H_
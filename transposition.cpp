@@ -0,0 +1,55 @@
+#include "transposition.hpp"
+
+#include <cstring>
+
+namespace {
+
+// data is the value's bits, the depth above them and a bit saying the slot is in use, so an
+// empty slot never matches a key of 0
+constexpr std::uint64_t used = std::uint64_t(1) << 63;
+
+std::uint64_t pack(int depth, float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    return used | std::uint64_t(std::uint8_t(depth)) << 32 | bits;
+}
+
+}  // namespace
+
+TranspositionTable::TranspositionTable(std::size_t size)
+{
+    std::size_t rounded = 1;
+    while (rounded < size)
+        rounded *= 2;
+    slots = std::make_unique<Slot[]>(rounded);
+    mask = rounded - 1;
+}
+
+bool TranspositionTable::probe(std::uint64_t key, int depth, float& value) const
+{
+    const Slot& slot = slots[key & mask];
+    std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+    std::uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if (!(data & used) || (check ^ data) != key || int((data >> 32) & 0xff) != depth)
+        return false;
+    std::uint32_t bits = data;
+    std::memcpy(&value, &bits, sizeof value);
+    return true;
+}
+
+void TranspositionTable::store(std::uint64_t key, int depth, float value)
+{
+    Slot& slot = slots[key & mask];
+    std::uint64_t data = pack(depth, value);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear()
+{
+    for (std::size_t i = 0; i <= mask; i++) {
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
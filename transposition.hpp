@@ -0,0 +1,41 @@
+#ifndef TRANSPOSITION_H_
+#define TRANSPOSITION_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// values of searched positions, shared by every thread of a search without locks
+//
+// a slot is two 64 bit words, the data and the key xored with the data. threads read and write
+// both words with plain atomic loads and stores, so a slot being written by one thread while
+// another reads it can come out as the halves of two different entries. those do not xor back
+// to the key being looked for and read as a miss, the same as an entry that was replaced
+
+class TranspositionTable
+{
+public:
+    // slots, rounded up to a power of 2
+    explicit TranspositionTable(std::size_t size);
+
+    // the value stored for a position searched to exactly this depth
+    bool probe(std::uint64_t key, int depth, float& value) const;
+
+    // replaces whatever was in the slot
+    void store(std::uint64_t key, int depth, float value);
+
+    void clear();
+
+private:
+    struct Slot
+    {
+        std::atomic<std::uint64_t> check{0};
+        std::atomic<std::uint64_t> data{0};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t mask;
+};
+
+#endif  // TRANSPOSITION_H_
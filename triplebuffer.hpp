@@ -0,0 +1,46 @@
+#ifndef TRIPLEBUFFER_H_
+#define TRIPLEBUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+
+// hands values from one writer thread to one reader thread, without either ever waiting
+//
+// there are three slots: the writer owns one, the reader owns one and the third is shared.
+// publishing swaps the writer's slot with the shared one, reading swaps the reader's slot
+// with the shared one if something new was published since. both are a single atomic
+// exchange, so a writer is never held up by a slow reader or the other way round, the reader
+// just skips values it was too slow to see
+
+template <typename T> class TripleBuffer
+{
+public:
+    // the slot to fill before calling publish, only for the writer
+    T& back() { return slots[backIndex]; }
+
+    // make the back slot the latest value, and take a new back slot
+    void publish() { backIndex = shared.exchange(backIndex | fresh) & index; }
+
+    // take the latest value if there is a new one, returns whether there was, only for the
+    // reader
+    bool update()
+    {
+        if (!(shared.load(std::memory_order_relaxed) & fresh)) return false;
+        frontIndex = shared.exchange(frontIndex) & index;
+        return true;
+    }
+
+    // the latest value taken by update, stays untouched until the next update
+    const T& front() { return slots[frontIndex]; }
+
+private:
+    static constexpr std::uint8_t index = 3;
+    static constexpr std::uint8_t fresh = 4;
+
+    T slots[3] = {};
+    std::uint8_t backIndex = 0;
+    std::uint8_t frontIndex = 1;
+    std::atomic<std::uint8_t> shared{2};
+};
+
+#endif  // TRIPLEBUFFER_H_
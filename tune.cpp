@@ -0,0 +1,325 @@
+#include "features.hpp"
+#include "generator.hpp"
+#include "movegen.hpp"
+#include "pool.hpp"
+#include "scoring.hpp"
+#include "search.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// tunes the evaluation weights of the bots with a genetic algorithm
+//
+// every generation, each candidate set of weights plays the same seeded headless games, one
+// piece at a time with the best placement by its own evaluation, and scores the mean points
+// it made. all candidates of a generation get the same seeds, so the differences between
+// them come from the weights and not from some getting easier pieces, and every generation
+// gets new seeds, so weights that only suit a few games do not last. the games of all
+// candidates are jobs on a ThreadPool, spread over every core
+//
+// the best few candidates go into the next generation as they are, the rest are children of
+// two parents picked by tournament, each weight taken from either at random and then
+// mutated. after every generation the population and the state of the random engine are
+// written to a checkpoint, and an interrupted run started again with the same checkpoint
+// carries on exactly where it stopped. a checkpoint that is there but can not be read stops
+// the run instead of starting a new one over it
+//
+//   tetris-tune [-c checkpoint] [-p population] [-g generations] [-k games] [-n pieces]
+//               [-j threads] [-s seed]
+//
+// a run is resumed with the settings it was started with, whatever the command line says
+
+namespace {
+
+const char* checkpointMagic = "tetris-tune-1";
+
+struct Settings
+{
+    int population = 24;
+    int games = 16;
+    int pieces = 500;
+    unsigned int seed = 1;
+};
+
+struct Checkpoint
+{
+    Settings settings;
+
+    // the generation to play next
+    int generation = 0;
+
+    std::mt19937 engine;
+    std::vector<Weights> population;
+
+    // the best of the last generation played, to show on resuming
+    float bestFitness = 0;
+    Weights best = defaultWeights;
+};
+
+// candidates that go into the next generation unchanged, and the tournament size
+constexpr int elites = 2;
+constexpr int tournament = 3;
+
+// chance of mutating each weight, and the size of a mutation relative to the weight
+constexpr double mutationRate = 0.3;
+constexpr double mutationScale = 0.25;
+
+// the seed of a game, the same for every candidate of a generation
+unsigned int gameSeed(const Settings& settings, int generation, int game)
+{
+    std::seed_seq sequence{settings.seed, unsigned(generation), unsigned(game)};
+    unsigned int seed;
+    sequence.generate(&seed, &seed + 1);
+    return seed;
+}
+
+// points a greedy player with these weights makes in a game, which ends when it tops out or
+// has placed the given number of pieces
+int play(const Weights& weights, unsigned int seed, int pieces)
+{
+    RandomGenerator generator(seed);
+    FeatureBoard board;
+    Scorer scorer;
+    Piece active = generator.getNextPiece();
+    Piece next = generator.getNextPiece();
+    std::optional<Piece> held;
+    std::vector<Placement> found;
+    int points = 0;
+
+    for (int placed = 0; placed < pieces; placed++) {
+        PaddedBoard padded = pad(board);
+        Placement best;
+        bool hold = false;
+        float bestValue = -std::numeric_limits<float>::infinity();
+        BoardFeatures bestFeatures;
+        auto consider = [&](Piece piece, bool holding) {
+            placements(padded, piece, found);
+            for (const Placement& placement : found) {
+                BoardFeatures features = board.after(placement.cells());
+                float value = evaluate(weights, features, placement.spin);
+                if (value > bestValue) {
+                    bestValue = value;
+                    best = placement;
+                    bestFeatures = features;
+                    hold = holding;
+                }
+            }
+        };
+        consider(active, false);
+        Piece other = held ? *held : next;
+        if (other != active) consider(other, true);
+        if (bestValue == -std::numeric_limits<float>::infinity() || bestFeatures.toppedOut)
+            break;
+
+        board.add(best.cells());
+        int lines = board.clearLines();
+        points += scorer.lock(lines, best.spin, board.getFeatures().aggregateHeight == 0).points;
+
+        // holding with an empty slot brings the next piece in, which is used up as well
+        if (hold && !held) {
+            held = active;
+            active = generator.getNextPiece();
+            next = generator.getNextPiece();
+        } else {
+            if (hold) held = active;
+            active = next;
+            next = generator.getNextPiece();
+        }
+    }
+    return points;
+}
+
+Weights mutate(Weights weights, std::mt19937& engine)
+{
+    std::uniform_real_distribution<double> chance(0, 1);
+    std::normal_distribution<double> noise(0, mutationScale);
+    for (float& weight : weights) {
+        // weights near 0 still move, by at least a tenth
+        if (chance(engine) < mutationRate)
+            weight += noise(engine) * std::max(std::abs(weight), 0.1f);
+    }
+    return weights;
+}
+
+bool save(const Checkpoint& checkpoint, const std::string& path)
+{
+    // through a temporary file, so an interrupted write leaves the last checkpoint whole
+    std::string temporary = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary);
+        file.precision(std::numeric_limits<float>::max_digits10);
+        const Settings& s = checkpoint.settings;
+        file << checkpointMagic << '\n'
+             << s.population << ' ' << s.games << ' ' << s.pieces << ' ' << s.seed << '\n'
+             << checkpoint.generation << '\n'
+             << checkpoint.engine << '\n'
+             << checkpoint.bestFitness;
+        for (float weight : checkpoint.best)
+            file << ' ' << weight;
+        file << '\n';
+        for (const Weights& weights : checkpoint.population) {
+            for (int i = 0; i < WeightCount; i++)
+                file << (i > 0 ? " " : "") << weights[i];
+            file << '\n';
+        }
+        if (!file) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load(Checkpoint& checkpoint, const std::string& path)
+{
+    std::ifstream file(path);
+    std::string magic;
+    if (!(file >> magic) || magic != checkpointMagic) return false;
+    Settings& s = checkpoint.settings;
+    file >> s.population >> s.games >> s.pieces >> s.seed >> checkpoint.generation
+        >> checkpoint.engine >> checkpoint.bestFitness;
+    if (!file || s.population <= elites || s.games <= 0 || s.pieces <= 0) return false;
+    for (float& weight : checkpoint.best)
+        file >> weight;
+    checkpoint.population.assign(s.population, Weights());
+    for (Weights& weights : checkpoint.population) {
+        for (float& weight : weights)
+            file >> weight;
+    }
+    // anything left over is from some other format, with more weights or a bigger population
+    return file && (file >> std::ws).eof();
+}
+
+void print(const Weights& weights)
+{
+    for (int i = 0; i < WeightCount; i++)
+        std::cout << (i > 0 ? ", " : "") << weights[i];
+    std::cout << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string path = "tune.checkpoint";
+    Settings settings;
+    int generations = 100;
+    int threads = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:p:g:k:n:j:s:")) != -1) {
+        switch (opt) {
+        case 'c': path = optarg; break;
+        case 'p': settings.population = std::atoi(optarg); break;
+        case 'g': generations = std::atoi(optarg); break;
+        case 'k': settings.games = std::atoi(optarg); break;
+        case 'n': settings.pieces = std::atoi(optarg); break;
+        case 'j': threads = std::atoi(optarg); break;
+        case 's': settings.seed = std::strtoul(optarg, nullptr, 10); break;
+        default:
+            std::cerr << "usage: " << argv[0]
+                      << " [-c checkpoint] [-p population] [-g generations] [-k games]"
+                      << " [-n pieces] [-j threads] [-s seed]" << std::endl;
+            return -1;
+        }
+    }
+    if (settings.population <= elites || settings.games <= 0 || settings.pieces <= 0
+        || generations <= 0 || threads < 0)
+        return -1;
+
+    // only a checkpoint that is not there starts a new run. one that can not be read is left
+    // alone, the first save would write over a run that may have taken days
+    Checkpoint checkpoint;
+    if (access(path.c_str(), F_OK) == 0 || errno != ENOENT) {
+        if (!load(checkpoint, path)) {
+            std::cerr << "could not read the checkpoint " << path
+                      << ", move it away to start a new run" << std::endl;
+            return 1;
+        }
+        std::cout << "resuming " << path << " at generation " << checkpoint.generation
+                  << ", best so far " << checkpoint.bestFitness << std::endl;
+    } else {
+        // the default weights and mutations of them
+        checkpoint.settings = settings;
+        checkpoint.engine.seed(settings.seed);
+        checkpoint.population.push_back(defaultWeights);
+        while (int(checkpoint.population.size()) < settings.population)
+            checkpoint.population.push_back(mutate(defaultWeights, checkpoint.engine));
+    }
+    settings = checkpoint.settings;
+
+    ThreadPool pool(threads);
+    int candidates = settings.population;
+    std::vector<int> points(std::size_t(candidates) * settings.games);
+    for (int g = 0; g < generations; g++) {
+        int generation = checkpoint.generation;
+        auto start = std::chrono::steady_clock::now();
+        pool.parallelFor(points.size(), [&](int job) {
+            int candidate = job / settings.games, game = job % settings.games;
+            points[job] = play(checkpoint.population[candidate],
+                               gameSeed(settings, generation, game), settings.pieces);
+        });
+        std::vector<double> fitness(candidates);
+        for (int c = 0; c < candidates; c++) {
+            auto first = points.begin() + std::size_t(c) * settings.games;
+            fitness[c] = std::accumulate(first, first + settings.games, 0.0) / settings.games;
+        }
+        std::vector<int> ranked(candidates);
+        std::iota(ranked.begin(), ranked.end(), 0);
+        std::stable_sort(ranked.begin(), ranked.end(),
+                         [&](int a, int b) { return fitness[a] > fitness[b]; });
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        std::cout << "generation " << generation << ": best " << fitness[ranked[0]] << ", mean "
+                  << std::accumulate(fitness.begin(), fitness.end(), 0.0) / candidates << " ("
+                  << time.count() << "s)" << std::endl;
+
+        std::mt19937& engine = checkpoint.engine;
+        std::uniform_int_distribution<int> anyone(0, candidates - 1);
+        std::uniform_int_distribution<int> coin(0, 1);
+        auto pick = [&] {
+            int best = anyone(engine);
+            for (int i = 1; i < tournament; i++) {
+                int other = anyone(engine);
+                if (fitness[other] > fitness[best]) best = other;
+            }
+            return best;
+        };
+        std::vector<Weights> next;
+        for (int i = 0; i < elites; i++)
+            next.push_back(checkpoint.population[ranked[i]]);
+        while (int(next.size()) < candidates) {
+            const Weights& a = checkpoint.population[pick()];
+            const Weights& b = checkpoint.population[pick()];
+            Weights child;
+            for (int i = 0; i < WeightCount; i++)
+                child[i] = coin(engine) ? a[i] : b[i];
+            next.push_back(mutate(child, engine));
+        }
+        checkpoint.bestFitness = fitness[ranked[0]];
+        checkpoint.best = checkpoint.population[ranked[0]];
+        checkpoint.population = next;
+        checkpoint.generation++;
+        if (!save(checkpoint, path)) std::cerr << "could not write " << path << std::endl;
+    }
+
+    std::cout << "best weights of the last generation: ";
+    print(checkpoint.best);
+    return 0;
+}